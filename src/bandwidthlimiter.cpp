@@ -0,0 +1,229 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "bandwidthlimiter.h"
+
+// Refilling often keeps the transfer smooth instead of bursting once per
+// second.
+const int BandwidthLimiter::refillInterval = 100;
+
+BandwidthLimiter::BandwidthLimiter()
+{
+    m_rate = 0;
+    m_hostRate = 0;
+    m_tokens = 0;
+    m_waiting = false;
+
+    m_timer.setInterval(refillInterval);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(refill()));
+}
+
+void BandwidthLimiter::setRate(qint64 rate)
+{
+    m_rate = qMax(rate, Q_INT64_C(0));
+    m_tokens = m_rate * refillInterval / 1000;
+    m_readers.clear();
+    updateTimer();
+}
+
+void BandwidthLimiter::setHostRate(qint64 rate)
+{
+    m_hostRate = qMax(rate, Q_INT64_C(0));
+    m_hostTokens.clear();
+    m_readers.clear();
+    updateTimer();
+}
+
+void BandwidthLimiter::setWindow(const QTime &start, const QTime &end)
+{
+    m_windowStart = start;
+    m_windowEnd = end;
+}
+
+bool BandwidthLimiter::isLimited() const
+{
+    if (m_rate == 0 && m_hostRate == 0) {
+        return false;
+    }
+
+    if (!m_windowStart.isValid() || !m_windowEnd.isValid()
+        || m_windowStart == m_windowEnd)
+    {
+        return true;
+    }
+
+    QTime now = QTime::currentTime();
+
+    // The window spans midnight.
+    if (m_windowStart > m_windowEnd) {
+        return now >= m_windowStart || now < m_windowEnd;
+    }
+    return now >= m_windowStart && now < m_windowEnd;
+}
+
+qint64 BandwidthLimiter::request(const QObject *reader, const QString &host,
+    qint64 wanted)
+{
+    if (wanted <= 0 || !isLimited()) {
+        return wanted;
+    }
+
+    // A host that has not been seen yet starts with a full bucket.
+    if (m_hostRate > 0 && !m_hostTokens.contains(host)) {
+        m_hostTokens.insert(host, m_hostRate * refillInterval / 1000);
+    }
+
+    // A reader that joins between refills gets an even split of what is
+    // left instead of waiting for the next refill.
+    if (!m_readers.contains(reader)) {
+        int hostReaders = 1;
+        Q_FOREACH (const Reader &other, m_readers) {
+            if (other.host == host) {
+                hostReaders++;
+            }
+        }
+
+        Reader entry;
+        entry.host = host;
+        entry.share = getShare(host, m_readers.size() + 1, hostReaders);
+        m_readers.insert(reader, entry);
+    }
+    Reader &entry = m_readers[reader];
+    entry.active = true;
+
+    qint64 granted = wanted;
+
+    if (m_rate > 0) {
+        granted = qMin(granted, qMax(m_tokens, Q_INT64_C(0)));
+    }
+    if (m_hostRate > 0) {
+        granted = qMin(granted, qMax(m_hostTokens.value(host),
+            Q_INT64_C(0)));
+    }
+    if (entry.share >= 0) {
+        granted = qMin(granted, entry.share);
+        entry.share -= granted;
+    }
+
+    if (granted < wanted) {
+        m_waiting = true;
+    }
+
+    consume(host, granted);
+
+    return granted;
+}
+
+void BandwidthLimiter::consume(const QString &host, qint64 bytes)
+{
+    if (m_rate > 0) {
+        m_tokens -= bytes;
+    }
+    if (m_hostRate > 0) {
+        m_hostTokens[host] -= bytes;
+    }
+}
+
+void BandwidthLimiter::refill()
+{
+    int elapsed = m_lastRefill.restart();
+    // QTime wraps at midnight.
+    if (elapsed < 0 || elapsed > 1000) {
+        elapsed = refillInterval;
+    }
+
+    // Allow at most one second worth of data to build up so an idle period
+    // is not followed by a large burst.
+    if (m_rate > 0) {
+        m_tokens = qMin(m_tokens + m_rate * elapsed / 1000, m_rate);
+    }
+    if (m_hostRate > 0) {
+        QMutableHashIterator<QString, qint64> it(m_hostTokens);
+        while (it.hasNext()) {
+            it.next();
+            it.setValue(qMin(it.value() + m_hostRate * elapsed / 1000,
+                m_hostRate));
+        }
+    }
+
+    updateShares();
+
+    // Readers that were told to wait can try again. Outside of the window
+    // this lets them read everything they are holding.
+    if (m_waiting) {
+        m_waiting = false;
+        emit bytesAvailable();
+    }
+}
+
+void BandwidthLimiter::updateTimer()
+{
+    if (m_rate > 0 || m_hostRate > 0) {
+        if (!m_timer.isActive()) {
+            m_lastRefill.start();
+            m_timer.start();
+        }
+    }
+    else {
+        m_timer.stop();
+    }
+}
+
+void BandwidthLimiter::updateShares()
+{
+    QHash<QString, int> hostReaders;
+
+    QMutableHashIterator<const QObject *, Reader> it(m_readers);
+    while (it.hasNext()) {
+        it.next();
+        if (!it.value().active) {
+            it.remove();
+        }
+        else {
+            hostReaders[it.value().host]++;
+        }
+    }
+
+    it.toFront();
+    while (it.hasNext()) {
+        it.next();
+        Reader &entry = it.value();
+        entry.share = getShare(entry.host, m_readers.size(),
+            hostReaders.value(entry.host));
+        entry.active = false;
+    }
+}
+
+qint64 BandwidthLimiter::getShare(const QString &host, int readers,
+    int hostReaders) const
+{
+    qint64 share = -1;
+
+    if (m_rate > 0) {
+        share = qMax(m_tokens, Q_INT64_C(0)) / readers;
+    }
+    if (m_hostRate > 0) {
+        qint64 hostShare = qMax(m_hostTokens.value(host), Q_INT64_C(0))
+            / hostReaders;
+        share = share < 0 ? hostShare : qMin(share, hostShare);
+    }
+
+    return share;
+}
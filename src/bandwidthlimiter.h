@@ -0,0 +1,213 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef BANDWIDTHLIMITER_H
+#define BANDWIDTHLIMITER_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTime>
+#include <QTimer>
+
+/**
+ * Limits the rate data is read from the network.
+ *
+ * A token bucket is kept for the total rate and, optionally, for each host.
+ * Readers ask for the number of bytes they want to read and are told how
+ * many they can read. When a reader is given less than it asked for it
+ * should wait for the bytesAvailable signal before trying again.
+ *
+ * Each refill is split between the readers that have asked for data since
+ * the last refill so the first reader to be told about the refill does not
+ * take all of it. A share a reader does not use stays in the bucket and is
+ * split again at the next refill.
+ *
+ * The limits can be restricted to a time of day window. Outside of the
+ * window reads are not limited.
+ */
+class BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+    public:
+        BandwidthLimiter();
+
+        /**
+         * Sets the maximum total rate.
+         *
+         * @param rate The rate in bytes per second. 0 for no limit.
+         */
+        void setRate(qint64 rate);
+        /**
+         * Sets the maximum rate for each host.
+         *
+         * @param rate The rate in bytes per second. 0 for no limit.
+         */
+        void setHostRate(qint64 rate);
+        /**
+         * Sets the time of day the limits apply.
+         *
+         * The window can span midnight. If start and end are the same, or
+         * either is invalid, the limits apply all day.
+         *
+         * @param start The time the limits start applying.
+         * @param end The time the limits stop applying.
+         */
+        void setWindow(const QTime &start, const QTime &end);
+
+        /**
+         * Are reads currently being limited.
+         *
+         * @return True if a limit is set and the current time is within the
+         * window.
+         */
+        bool isLimited() const;
+        /**
+         * Ask to read data from a host.
+         *
+         * The bytes granted are taken from the buckets and from the reader's
+         * share of the last refill.
+         *
+         * @param reader The connection the data is being read from.
+         * @param host The host the data is being read from.
+         * @param wanted The number of bytes the reader wants to read.
+         *
+         * @return The number of bytes that can be read.
+         */
+        qint64 request(const QObject *reader, const QString &host,
+            qint64 wanted);
+        /**
+         * Take bytes that have already been read from the buckets.
+         *
+         * This is for data that had to be read regardless of the limit. The
+         * buckets can go negative. The debt is paid before other reads are
+         * allowed.
+         *
+         * @param host The host the data was read from.
+         * @param bytes The number of bytes read.
+         */
+        void consume(const QString &host, qint64 bytes);
+
+    signals:
+        /**
+         * This signal is emitted when the buckets have been refilled and a
+         * reader was told to wait.
+         */
+        void bytesAvailable();
+
+    private slots:
+        /**
+         * Refill the buckets based on the time since the last refill.
+         */
+        void refill();
+
+    private:
+        /**
+         * A reader that has asked for data since the last refill.
+         */
+        struct Reader
+        {
+            /**
+             * The host the reader is reading from.
+             */
+            QString host;
+            /**
+             * The bytes the reader can still read before the next refill.
+             */
+            qint64 share;
+            /**
+             * Whether the reader asked for data since the last refill.
+             */
+            bool active;
+        };
+
+        /**
+         * Start or stop the refill timer depending on if any limit is set.
+         */
+        void updateTimer();
+        /**
+         * Split the buckets between the readers that are still active.
+         *
+         * Readers that have not asked for data since the last refill are
+         * forgotten.
+         */
+        void updateShares();
+        /**
+         * The share of the buckets a reader gets.
+         *
+         * @param host The host the reader is reading from.
+         * @param readers The number of readers.
+         * @param hostReaders The number of readers reading from the host.
+         *
+         * @return The number of bytes the reader can read. -1 if there is
+         * no limit.
+         */
+        qint64 getShare(const QString &host, int readers,
+            int hostReaders) const;
+
+        /**
+         * The total rate in bytes per second.
+         */
+        qint64 m_rate;
+        /**
+         * The rate for each host in bytes per second.
+         */
+        qint64 m_hostRate;
+        /**
+         * The bytes that can be read in total.
+         */
+        qint64 m_tokens;
+        /**
+         * The bytes that can be read from each host.
+         */
+        QHash<QString, qint64> m_hostTokens;
+        /**
+         * The readers sharing the buckets.
+         */
+        QHash<const QObject *, Reader> m_readers;
+        /**
+         * When the limits start applying.
+         */
+        QTime m_windowStart;
+        /**
+         * When the limits stop applying.
+         */
+        QTime m_windowEnd;
+        /**
+         * Whether a reader was given less than it wanted.
+         */
+        bool m_waiting;
+        /**
+         * Refills the buckets.
+         */
+        QTimer m_timer;
+        /**
+         * The time since the buckets were last refilled.
+         */
+        QTime m_lastRefill;
+
+        /**
+         * How often the buckets are refilled in milliseconds.
+         */
+        static const int refillInterval;
+};
+
+#endif /* BANDWIDTHLIMITER_H */
@@ -0,0 +1,72 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "bufferedwritebackend.h"
+
+BufferedWriteBackend::~BufferedWriteBackend()
+{
+    Q_FOREACH (int handle, m_files.keys()) {
+        close(handle);
+    }
+}
+
+QString BufferedWriteBackend::getName() const
+{
+    return "buffered";
+}
+
+bool BufferedWriteBackend::open(int handle, const QString &path)
+{
+    QFile *file = new QFile(path);
+
+    if (!file->open(QIODevice::ReadWrite)) {
+        delete file;
+        return false;
+    }
+
+    m_files.insert(handle, file);
+    return true;
+}
+
+bool BufferedWriteBackend::write(int handle, qint64 position,
+    const char *data, qint64 size)
+{
+    QFile *file = m_files.value(handle);
+
+    if (!file || !file->seek(position)) {
+        return false;
+    }
+    return file->write(data, size) == size;
+}
+
+bool BufferedWriteBackend::close(int handle)
+{
+    QFile *file = m_files.take(handle);
+
+    if (!file) {
+        return false;
+    }
+
+    bool flushed = file->flush();
+    file->close();
+    delete file;
+
+    return flushed;
+}
@@ -0,0 +1,52 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef BUFFEREDWRITEBACKEND_H
+#define BUFFEREDWRITEBACKEND_H
+
+#include <QFile>
+#include <QHash>
+
+#include "writebackend.h"
+
+/**
+ * Writes through QFile and the operating system's cache.
+ *
+ * Works on every platform.
+ */
+class BufferedWriteBackend : public WriteBackend
+{
+    public:
+        ~BufferedWriteBackend();
+
+        QString getName() const;
+        bool open(int handle, const QString &path);
+        bool write(int handle, qint64 position, const char *data,
+            qint64 size);
+        bool close(int handle);
+
+    private:
+        /**
+         * The open files.
+         */
+        QHash<int, QFile *> m_files;
+};
+
+#endif /* BUFFEREDWRITEBACKEND_H */
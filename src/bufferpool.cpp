@@ -0,0 +1,80 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <QMutexLocker>
+
+#include "bufferpool.h"
+
+BufferPool::BufferPool(int bufferSize, int bufferCount)
+{
+    m_bufferSize = qMax(bufferSize, 1);
+    m_bufferCount = qMax(bufferCount, 1);
+    m_allocatedCount = 0;
+}
+
+BufferPool::~BufferPool()
+{
+    // Buffers still in use are owned by whoever took them.
+    Q_FOREACH (char *buffer, m_free) {
+        delete[] buffer;
+    }
+}
+
+int BufferPool::getBufferSize() const
+{
+    return m_bufferSize;
+}
+
+qint64 BufferPool::getAllocatedSize()
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<qint64>(m_allocatedCount) * m_bufferSize;
+}
+
+int BufferPool::getAvailableCount()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_free.size() + m_bufferCount - m_allocatedCount;
+}
+
+char *BufferPool::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_free.isEmpty()) {
+        return m_free.takeLast();
+    }
+    if (m_allocatedCount >= m_bufferCount) {
+        return 0;
+    }
+
+    m_allocatedCount++;
+    return new char[m_bufferSize];
+}
+
+void BufferPool::release(char *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_free.append(buffer);
+}
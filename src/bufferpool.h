@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QList>
+#include <QMutex>
+
+/**
+ * A fixed number of reusable buffers.
+ *
+ * Episode data is read from the network into a buffer from the pool and
+ * written to disk from it. Reusing the buffers keeps memory use from growing
+ * with the number of reads. Buffers are only allocated the first time they
+ * are needed.
+ *
+ * The pool can be used from more than one thread.
+ */
+class BufferPool
+{
+    public:
+        /**
+         * @param bufferSize The size of each buffer in bytes.
+         * @param bufferCount The maximum number of buffers.
+         */
+        BufferPool(int bufferSize, int bufferCount);
+        ~BufferPool();
+
+        /**
+         * Gets the size of each buffer.
+         *
+         * @return The size in bytes.
+         */
+        int getBufferSize() const;
+        /**
+         * Gets the memory used by the buffers allocated so far.
+         *
+         * @return The size in bytes.
+         */
+        qint64 getAllocatedSize();
+        /**
+         * Gets the number of buffers that can still be taken.
+         *
+         * @return The number of free and not yet allocated buffers.
+         */
+        int getAvailableCount();
+        /**
+         * Take a buffer from the pool.
+         *
+         * @return A buffer of getBufferSize bytes. 0 if every buffer is in
+         * use.
+         */
+        char *acquire();
+        /**
+         * Return a buffer to the pool.
+         *
+         * @param buffer A buffer taken with acquire.
+         */
+        void release(char *buffer);
+
+    private:
+        /**
+         * The size of each buffer in bytes.
+         */
+        int m_bufferSize;
+        /**
+         * The maximum number of buffers.
+         */
+        int m_bufferCount;
+        /**
+         * The number of buffers that have been allocated.
+         */
+        int m_allocatedCount;
+        /**
+         * Allocated buffers that are not in use.
+         */
+        QList<char *> m_free;
+        /**
+         * Guards the free list.
+         */
+        QMutex m_mutex;
+};
+
+#endif /* BUFFERPOOL_H */
@@ -19,11 +19,15 @@
  *****************************************************************************/
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QSet>
 #include <QStringList>
+#include <QtAlgorithms>
 
 #include <stdlib.h>
 
@@ -33,13 +37,31 @@
 #include "platform.h"
 #include "podcastlistingsparser.h"
 
+const int Client::readChunkSize = 65536;
+const int Client::writerBuffersPerThread = 4;
+const int Client::responseDelaySamples = 100;
+const int Client::hedgeMinimumSamples = 10;
+
 Client::Client()
 {
     m_errStream = new QTextStream(stderr);
     m_outStream = new QTextStream(stdout);
     m_database = new Database();
     m_networkAccessManager = new QNetworkAccessManager();
+    m_bandwidthLimiter = new BandwidthLimiter();
+    m_retryQueue = new RetryQueue();
+    m_bufferPool = 0;
+    m_diskWriter = 0;
+    m_hashAlgorithm = ContentHash::Sha256Hash;
     m_activeDownloadCount = 0;
+    m_activeRSSCount = 0;
+    m_activeSegmentCount = 0;
+    m_hedgeCount = 0;
+    m_hedgeWinCount = 0;
+    m_feedTransferredBytes = 0;
+    m_feedDecodedBytes = 0;
+    m_notModifiedCount = 0;
+    m_unchangedFeedCount = 0;
     m_settingsManager = new SettingsManager();
     m_initMode = false;
     m_verboseMode = false;
@@ -51,6 +73,11 @@ Client::~Client()
     delete m_outStream;
     delete m_database;
     delete m_networkAccessManager;
+    delete m_bandwidthLimiter;
+    delete m_retryQueue;
+    // The writer returns the buffers still in its queue to the pool.
+    delete m_diskWriter;
+    delete m_bufferPool;
     delete m_settingsManager;
 }
 
@@ -60,75 +87,194 @@ void Client::run()
     parseOptions();
     loadDatabase();
     loadPodcasts();
+    loadBandwidthLimiter();
+    loadDiskWriter();
+
+    // Each running download holds at most one buffer at a time. Buffers
+    // waiting to be written are held by the disk writer. Limiting the
+    // number of buffers limits how far the writer can fall behind.
+    int bufferCount = m_settingsManager->getThreadCount();
+    if (m_diskWriter) {
+        bufferCount *= writerBuffersPerThread;
+    }
+    m_bufferPool = new BufferPool(readChunkSize, bufferCount);
+
+    m_diskSpaceManager.setPath(m_settingsManager->getSaveLocation());
+    m_diskSpaceManager.setMinimumFreeSpace(
+        m_settingsManager->getMinimumFreeDiskSpace());
+
+    bool knownOrder;
+    m_episodeQueue.setPolicy(EpisodeQueue::policyFromName(
+        m_settingsManager->getEpisodeOrder(), &knownOrder));
+    if (!knownOrder) {
+        error(tr("Unknown episode order %1. Using round_robin.")
+            .arg(m_settingsManager->getEpisodeOrder()), false);
+    }
 
-    // Start downloading the rss feeds. The number of downloads started is
-    // the minimum of the user defined download thread count and the number
-    // of podcasts in the queue. Calling more threads than there are items
-    // wouldn't do anything productive.
-    for (int i = 0; i < qMin(m_settingsManager->getThreadCount(),
-        m_podcastRSSQueue.size()); i++)
+    QString syncPolicy = m_settingsManager->getSyncPolicy().trimmed()
+        .toLower();
+    if (syncPolicy != "file" && syncPolicy != "batch"
+        && syncPolicy != "none")
     {
-        startRSSDownload();
+        error(tr("Unknown sync policy %1. Using file.").arg(syncPolicy),
+            false);
+        syncPolicy = "file";
     }
+    m_settingsManager->setSyncPolicy(syncPolicy);
+
+    bool knownHash;
+    m_hashAlgorithm = ContentHash::algorithmFromName(
+        m_settingsManager->getHashAlgorithm(), &knownHash);
+    if (!knownHash) {
+        error(tr("Unknown hash algorithm %1. Using sha256.")
+            .arg(m_settingsManager->getHashAlgorithm()), false);
+    }
+
+    // Spread out the retries of downloads that failed at the same time.
+    qsrand(QDateTime::currentDateTime().toTime_t());
+    connect(m_retryQueue, SIGNAL(ready()), this, SLOT(downloadNext()));
+
+    // Start downloading the rss feeds. downloadNext starts as many
+    // downloads as the thread count and the per host connection limit
+    // allow.
+    downloadNext();
 }
 
 void Client::downloadNext()
 {
-    // Check disk space requirements
-    if (m_settingsManager->getMinimumFreeDiskSpace() < 0
-        ||
-        Platform::getFreeDiskSpace(m_settingsManager->getSaveLocation()) <= -1
-        || Platform::getFreeDiskSpace(m_settingsManager->getSaveLocation())
-        > m_settingsManager->getMinimumFreeDiskSpace())
+    // Fill every free thread. Rss feeds are downloaded before episodes
+    // except for the share of threads reserved for episodes. Podcasts whose
+    // host is at its connection limit are skipped so the threads can be used
+    // for other hosts. Episodes that do not fit in the free disk space are
+    // skipped as well.
+    while (m_activeDownloadCount + m_activeSegmentCount
+        < m_settingsManager->getThreadCount())
     {
-        if (!m_podcastRSSQueue.isEmpty()) {
+        // Retries have already waited their turn.
+        DownloadItem *retry = findAvailableRetry();
+        if (retry) {
+            startRetry(retry);
+            continue;
+        }
+
+        int rssIndex = findAvailablePodcast();
+        int episodeIndex = findAvailableEpisode();
+
+        if (rssIndex != -1
+            && (episodeIndex == -1 || isRSSThreadAvailable()))
+        {
+            m_podcastRSSQueue.move(rssIndex, 0);
             startRSSDownload();
+            continue;
         }
-        else if (!m_podcastDownloadQueue.isEmpty()) {
-            startEpisodeDownload();
 
-            // This takes care of cases where there are less podcasts than
-            // threads. So the number of threads started is the number of
-            // podcasts. Podcasts can have more episodes than the number of
-            // podcasts. This will start more downloads to bring it up to the
-            // number set by the user.
-            while (m_activeDownloadCount < m_settingsManager->getThreadCount()
-                && !m_podcastDownloadQueue.isEmpty())
-            {
-                startEpisodeDownload();
+        if (episodeIndex != -1) {
+            startQueuedEpisode(episodeIndex);
+            continue;
+        }
+
+        // Everything left is waiting on a busy host or disk space.
+        break;
+    }
+
+    // Episodes that do not fit wait for the running downloads to release
+    // their reservations. Once nothing is running they never will fit. Any
+    // retry that is ready but was not started is such an episode.
+    if (m_activeDownloadCount == 0) {
+        QList<PodcastEpisode *> unfit;
+        Q_FOREACH (DownloadItem *item, m_retryQueue->getReadyItems()) {
+            PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+            if (episode) {
+                unfit.append(episode);
             }
         }
+
+        if (!unfit.isEmpty()) {
+            error(tr("Not enough free space to download %1 episodes.")
+                .arg(unfit.size()), false);
+        }
+        Q_FOREACH (PodcastEpisode *episode, unfit) {
+            m_retryQueue->remove(episode);
+            m_retryAttempts.remove(episode);
+            episodeFailed(episode);
+            episode->deleteLater();
+        }
     }
-    // Not enough free disk space to continue downloading.
-    else {
-        error(tr("Not enough free space to continue downloading."), false);
-        // Empty the queues. Once any current downloads finish the application
-        // will exit.
-        while (!m_podcastRSSQueue.isEmpty()) {
-            m_podcastRSSQueue.dequeue()->deleteLater();
-        }
-        while (!m_podcastDownloadQueue.isEmpty()) {
-            Podcast *podcast = m_podcastRSSQueue.dequeue();
-            podcast->clearEpisodeList();
+    if (m_activeDownloadCount == 0 && m_retryQueue->isEmpty()
+        && !m_episodeQueue.isEmpty())
+    {
+        error(tr("Not enough free space to download %1 episodes.")
+            .arg(m_episodeQueue.size()), false);
+        Q_FOREACH (Podcast *podcast, m_episodeQueue.clear()) {
             podcast->deleteLater();
         }
     }
 
-    // If there are no active downloads, exit.
-    if (m_activeDownloadCount == 0) {
+    // A batch is not held back once no more episodes are downloading.
+    if (m_activeDownloadCount == m_activeRSSCount
+        && !m_unpublishedEpisodes.isEmpty())
+    {
+        publishEpisodes();
+    }
+
+    // If there are no active downloads or downloads waiting to be tried
+    // again, exit.
+    if (m_activeDownloadCount == 0 && m_retryQueue->isEmpty()) {
+        summary();
         exit(0);
     }
 }
 
 void Client::downloadError(DownloadItem *item, QString errorString)
 {
-    *m_errStream << tr("Error: could not download %1 because %2")
-        .arg(item->getName()).arg(errorString) << endl;
+    releaseHost(item);
+
+    // Release the threads used by the segments of an episode.
+    PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+    if (episode) {
+        m_activeSegmentCount -= episode->getSegmentCount();
+        m_diskSpaceManager.release(episode);
+    }
 
     m_activeDownloadCount--;
-    downloadNext();
+    if (qobject_cast<Podcast *>(item)) {
+        m_activeRSSCount--;
+    }
 
-    item->deleteLater();
+    if (!scheduleRetry(item, errorString)) {
+        *m_errStream << tr("Error: could not download %1 because %2")
+            .arg(item->getName()).arg(errorString) << endl;
+
+        // The feed may have moved again or the move may have been undone.
+        // Start from the listings file url next time.
+        Podcast *podcast = qobject_cast<Podcast *>(item);
+        if (podcast && !podcast->getMovedUrl().isEmpty()) {
+            verbose(tr("Forgetting that %1 moved to %2.")
+                .arg(podcast->getName())
+                .arg(podcast->getMovedUrl().toString()));
+            m_database->setMovedUrl(podcast, QUrl());
+            podcast->setMovedUrl(QUrl());
+        }
+
+        if (episode) {
+            episodeFailed(episode);
+        }
+
+        // The server says the episode is not there. Its partial download
+        // will never be finished.
+        if (episode && episode->getFailureStatus() >= 400
+            && episode->getFailureStatus() < 500)
+        {
+            discardPartial(episode->getUrl().toString(),
+                episode->getPartialSaveLocation());
+        }
+
+        m_retryAttempts.remove(item);
+        m_knownEpisodeRuns.remove(item);
+        item->deleteLater();
+    }
+
+    downloadNext();
 }
 
 void Client::error(const QString &error, bool fatal)
@@ -150,23 +296,19 @@ void Client::startRSSDownload(DownloadItem *item, QUrl url)
     Podcast *podcast = static_cast<Podcast *>(item);
 
     QNetworkRequest request = getNetworkRequest();
+    // Feeds compress well. Podcast decodes them as they arrive.
+    request.setRawHeader("Accept-Encoding", "gzip, deflate");
 
     // New podcast download.
     if (!podcast) {
         m_activeDownloadCount++;
+        m_activeRSSCount++;
         podcast = m_podcastRSSQueue.dequeue();
-        url = podcast->getUrl();
-        QString lastModified = m_database->getLastModified(podcast);
-
-        if (!lastModified.isEmpty()
-            && !m_settingsManager->getIgnoreNotModified()
-            && !podcast->isIgnoreNotModified())
-        {
-            request.setRawHeader("If-Modified-Since", lastModified.toAscii());
-        }
+        url = getFeedUrl(podcast);
 
         connect(podcast, SIGNAL(contentMoved(DownloadItem *, QUrl)), this,
             SLOT(startRSSDownload(DownloadItem *, QUrl)));
+        setWatchdog(podcast);
 
         // downloadError, downloadItemNotModified, and finished are exclusive.
         // Only one will be called.
@@ -176,6 +318,33 @@ void Client::startRSSDownload(DownloadItem *item, QUrl url)
             SLOT(downloadItemNotModified(DownloadItem *)));
         connect(podcast, SIGNAL(finished(DownloadItem *)), this,
             SLOT(episodesReady(DownloadItem *)));
+        connect(podcast,
+            SIGNAL(episodeParsed(DownloadItem *, PodcastEpisode *)), this,
+            SLOT(episodeParsed(DownloadItem *, PodcastEpisode *)));
+    }
+    // A new reply starts reading the feed from the beginning.
+    m_knownEpisodeRuns.remove(podcast);
+
+    // Retries and redirects are requested conditionally as well. A podcast
+    // with partially downloaded episodes needs its feed parsed even if it
+    // has not changed so the episodes can be resumed.
+    if (!m_settingsManager->getIgnoreNotModified()
+        && !podcast->isIgnoreNotModified()
+        && !m_database->hasPartial(podcast))
+    {
+        QString lastModified = m_database->getLastModified(podcast);
+        QString eTag = m_database->getETag(podcast);
+
+        // Many servers only send one of Last-Modified and ETag. Either lets
+        // the server respond with 304 Not Modified.
+        if (!lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", lastModified.toAscii());
+        }
+        if (!eTag.isEmpty()) {
+            request.setRawHeader("If-None-Match", eTag.toAscii());
+        }
+        // For servers that ignore both and send the feed anyway.
+        podcast->setPreviousFeedHash(m_database->getFeedHash(podcast));
     }
 
     verbose(tr("Starting rss download for %1 from %2.").arg(podcast->getName())
@@ -184,6 +353,7 @@ void Client::startRSSDownload(DownloadItem *item, QUrl url)
     QNetworkReply *reply;
 
     // Start the download.
+    acquireHost(podcast, url);
     request.setUrl(url);
     reply = m_networkAccessManager->get(request);
     podcast->setNetworkReply(reply);
@@ -195,7 +365,33 @@ void Client::episodesReady(DownloadItem *item)
     // hence why there must be a cast to the derived class type.
     Podcast *podcast = static_cast<Podcast *>(item);
 
-    verbose(tr("Rss download finished for %1.").arg(podcast->getName()));
+    verbose(tr("Rss download finished for %1. Transferred %2 bytes, decoded"
+        " to %3 bytes.").arg(podcast->getName())
+        .arg(podcast->getTransferredBytes()).arg(podcast->getDecodedBytes()));
+
+    if (podcast->isStoppedEarly()) {
+        verbose(tr("Stopped reading the rss feed for %1 after %2 episodes.")
+            .arg(podcast->getName()).arg(podcast->getEpisodeCount()));
+    }
+
+    m_feedTransferredBytes += podcast->getTransferredBytes();
+    m_feedDecodedBytes += podcast->getDecodedBytes();
+
+    // The server sent the same feed as last time. Handle it like a 304
+    // so none of its episodes are looked up in the database.
+    if (podcast->isFeedUnchanged()) {
+        m_unchangedFeedCount++;
+        podcast->clearEpisodeList();
+        verbose(tr("Rss feed for %1 has not changed since the last time it"
+            " was downloaded.").arg(podcast->getName()));
+        downloadItemNotModified(podcast);
+        return;
+    }
+
+    releaseHost(podcast);
+    m_retryAttempts.remove(podcast);
+    m_knownEpisodeRuns.remove(podcast);
+    saveMovedUrl(podcast);
 
     if (podcast->isInit() || m_initMode) {
         // Mark all episodes as downloaded.
@@ -217,110 +413,175 @@ void Client::episodesReady(DownloadItem *item)
     }
     else {
         // Generate a list of episodes to download.
-        podcast->truncateEpisodes(m_settingsManager->getRecentEpisodeCount());
+        podcast->keepNewestEpisodes(
+            m_settingsManager->getRecentEpisodeCount());
+
+        // Remove downloaded and explicit if we are filtering explicit. They
+        // are collected first so the list is only rebuilt once.
+        QSet<PodcastEpisode *> unwanted;
         Q_FOREACH (PodcastEpisode *episode, podcast->getEpisodes()) {
-            // Remove downloaded and explicit if we are filtering explicit.
             if (m_database->isDownloaded(episode)
                 || (m_settingsManager->getFilterExplicit()
                 && episode->isExplicit()))
             {
-                podcast->removeEpisode(episode);
+                unwanted.insert(episode);
             }
         }
+        podcast->removeEpisodes(unwanted);
+        // Only the episodes that will be downloaded are sorted.
+        podcast->sortEpisodes();
+
+        // Episodes that were not parsed may still be in the feed.
+        if (!podcast->isStoppedEarly()) {
+            discardPartials(podcast);
+        }
 
         verbose(tr("Queuing %1 episodes from %2 for download.")
             .arg(podcast->getEpisodeCount()).arg(podcast->getName()));
 
         if (podcast->getEpisodeCount() > 0) {
-            m_podcastDownloadQueue.enqueue(podcast);
+            m_episodeQueue.enqueue(podcast);
         }
         else {
             // Set the modified date for the rss feed. We are setting it here
             // becuase there are no episodes to download. Otherwise the date
             // will be set when the last episode download for the particular
             // podcast starts.
-            m_database->setLastModified(podcast);
+            saveLastModified(podcast);
 
             podcast->deleteLater();
         }
     }
 
     m_activeDownloadCount--;
+    m_activeRSSCount--;
     downloadNext();
 }
 
-void Client::startEpisodeDownload(DownloadItem *item, QUrl url)
+void Client::episodeParsed(DownloadItem *item, PodcastEpisode *episode)
 {
-    // item is really a PodcastEpisode object. The signal is set in the base
-    // class hence why there must be a cast to the derived class type.
-    PodcastEpisode *episode = static_cast<PodcastEpisode *>(item);
+    // item is really a Podcast object. The signal is set in the derived
+    // class but uses the base class type like the other signals.
+    Podcast *podcast = static_cast<Podcast *>(item);
 
-    QNetworkRequest request = getNetworkRequest();
+    // Init mode needs every episode to mark it as downloaded.
+    int knownLimit = m_settingsManager->getStopAfterKnown();
+    if (knownLimit == 0 || podcast->isInit() || m_initMode) {
+        return;
+    }
 
-    // New episode download.
-    if (!episode) {
-        Podcast *podcast = m_podcastDownloadQueue.dequeue();
+    int run = 0;
+    if (m_database->isDownloaded(episode)) {
+        run = m_knownEpisodeRuns.value(podcast) + 1;
+    }
+    m_knownEpisodeRuns.insert(podcast, run);
 
-        episode = podcast->takeFirstEpisode();
-        url = episode->getUrl();
+    // Newer episodes come first so the rest of the feed is older than
+    // anything that would be downloaded.
+    int recentCount = m_settingsManager->getRecentEpisodeCount();
+    if (run >= knownLimit
+        || (recentCount > 0 && podcast->getEpisodeCount() >= recentCount))
+    {
+        podcast->stopReading();
+    }
+}
 
-        QDir fileDirectory(QString("%1/%2/%3")
-            .arg(m_settingsManager->getSaveLocation())
-            .arg(podcast->getCategory())
-            .arg(podcast->getName()));
+void Client::startQueuedEpisode(int index)
+{
+    Podcast *podcast = m_episodeQueue.podcastAt(index);
+    PodcastEpisode *episode = m_episodeQueue.take(index);
+
+    QDir fileDirectory(QString("%1/%2/%3")
+        .arg(m_settingsManager->getSaveLocation())
+        .arg(podcast->getCategory())
+        .arg(podcast->getName()));
+
+    // create the directory to download to.
+    if (!fileDirectory.exists()) {
+        if (!fileDirectory.mkpath(fileDirectory.path())) {
+            error(tr("Could not create directory: %1 to write %2 for %3.")
+                .arg(fileDirectory.path())
+                .arg(QFileInfo(episode->getUrl().toString()).fileName())
+                .arg(episode->getName()),
+                false);
+
+            // None of the podcast's episodes can be saved.
+            delete episode;
+            m_episodeQueue.removePodcast(podcast);
+            podcast->deleteLater();
+            return;
+        }
+    }
 
-        // create the directory to download to.
-        if (!fileDirectory.exists()) {
-            if (!fileDirectory.mkpath(fileDirectory.path())) {
-                error(tr("Could not create directory: %1 to write %2 for %3.")
-                    .arg(fileDirectory.path())
-                    .arg(QFileInfo(episode->getUrl().toString()).fileName())
-                    .arg(episode->getName()),
-                    false);
+    // Tell the episode where to download to.
+    episode->setSaveLocation(getSaveLocation(podcast, episode->getUrl()));
 
-                podcast->deleteLater();
+    if (m_episodeQueue.getPendingCount(podcast) == 0) {
+        // Set the modified date for the rss feed. If the download fails
+        // the partial download record keeps the feed from being treated
+        // as not modified so the episode will be resumed next time. An
+        // episode that fails without one clears the feed's hash.
+        saveLastModified(podcast);
 
-                if (podcast->getEpisodeCount() > 0) {
-                    podcast->clearEpisodeList();
-                    podcast->deleteLater();
-                }
+        podcast->deleteLater();
+    }
 
-                downloadNext();
-                return;
-            }
-        }
+    connect(episode, SIGNAL(contentMoved(DownloadItem *, QUrl)), this,
+        SLOT(startEpisodeDownload(DownloadItem *, QUrl)));
+    connect(episode, SIGNAL(error(DownloadItem *, QString)), this,
+        SLOT(downloadError(DownloadItem *, QString)));
+    connect(episode, SIGNAL(finished(DownloadItem *)), this,
+        SLOT(episodeDownloaded(DownloadItem *)));
+    connect(episode, SIGNAL(headersReceived(DownloadItem *)), this,
+        SLOT(episodeHeadersReceived(DownloadItem *)));
+    connect(episode, SIGNAL(hedgeRequested(DownloadItem *)), this,
+        SLOT(startEpisodeHedge(DownloadItem *)));
+    connect(episode, SIGNAL(hedgeResolved(DownloadItem *, bool)), this,
+        SLOT(episodeHedgeResolved(DownloadItem *, bool)));
+
+    if (m_settingsManager->getBandwidthLimit() > 0
+        || m_settingsManager->getHostBandwidthLimit() > 0)
+    {
+        episode->setBandwidthLimiter(m_bandwidthLimiter);
+    }
+    episode->setBufferPool(m_bufferPool);
+    episode->setDiskWriter(m_diskWriter);
+    episode->setHashAlgorithm(m_hashAlgorithm);
+    setWatchdog(episode);
+
+    m_activeDownloadCount++;
+    m_diskSpaceManager.reserve(episode, getExpectedSize(episode));
+    startEpisodeDownload(episode, episode->getUrl());
+}
+
+void Client::startEpisodeDownload(DownloadItem *item, QUrl url)
+{
+    // item is really a PodcastEpisode object. The signal is set in the base
+    // class hence why there must be a cast to the derived class type.
+    PodcastEpisode *episode = static_cast<PodcastEpisode *>(item);
+
+    QNetworkRequest request = getNetworkRequest();
 
-        // Tell the episode where to download to.
-        episode->setSaveLocation(QString("%1/%2")
-            .arg(fileDirectory.absolutePath())
-            .arg(QFileInfo(episode->getUrl().toString()).fileName()));
+    // TODO:
+    // re-calculate the file name and change the download file name when the
+    // content has moved.
 
-        if (podcast->getEpisodeCount() > 0) {
-            m_podcastDownloadQueue.enqueue(podcast);
+    // Continue from where a previous attempt left off. Without a validator
+    // there is no way to know if the partial data is still good.
+    if (episode->getResumeOffset() > 0) {
+        QString validator = m_database->getPartialValidator(episode);
+
+        if (validator.isEmpty()) {
+            episode->resetWrite();
         }
         else {
-            // Set the modified date for the rss feed.
-            // TODO: What happens if the download fail? It won't be
-            // re-downloaded until next time there are new items.
-            m_database->setLastModified(podcast);
+            request.setRawHeader("Range", QString("bytes=%1-")
+                .arg(episode->getResumeOffset()).toAscii());
+            request.setRawHeader("If-Range", validator.toAscii());
 
-            podcast->deleteLater();
+            verbose(tr("Resuming episode download for %1 at byte %2.")
+                .arg(episode->getName()).arg(episode->getResumeOffset()));
         }
-
-        connect(episode, SIGNAL(contentMoved(DownloadItem *, QUrl)), this,
-            SLOT(startEpisodeDownload(DownloadItem *, QUrl)));
-        connect(episode, SIGNAL(error(DownloadItem *, QString)), this,
-            SLOT(downloadError(DownloadItem *, QString)));
-        connect(episode, SIGNAL(finished(DownloadItem *)), this,
-            SLOT(episodeDownloaded(DownloadItem *)));
-
-        m_activeDownloadCount++;
-    }
-    else {
-        // Set the write buffer for the episode to the beginning of the file.
-        episode->resetWrite();
-        // TODO:
-        // re-calculate the file name and change the download file name.
     }
 
     verbose(tr("Starting episode download for %1 from %2 and saving to %3.")
@@ -330,11 +591,68 @@ void Client::startEpisodeDownload(DownloadItem *item, QUrl url)
     QNetworkReply *reply;
 
     // Start the download.
+    acquireHost(episode, url);
     request.setUrl(url);
     reply = m_networkAccessManager->get(request);
+    episode->setHedgeDelay(getHedgeDelay());
     episode->setNetworkReply(reply);
 }
 
+void Client::startEpisodeHedge(DownloadItem *item)
+{
+    // item is really a PodcastEpisode object. The signal is set in the
+    // derived class but uses the base class type like the other signals.
+    PodcastEpisode *episode = static_cast<PodcastEpisode *>(item);
+
+    // The same request, including any range, so either response can be
+    // used.
+    QNetworkRequest request = episode->getRequest();
+    if (m_settingsManager->getHedgeOriginalUrl()) {
+        request.setUrl(episode->getUrl());
+    }
+
+    // The second request counts against the host like any other
+    // connection.
+    if (!isHostAvailable(request.url())) {
+        verbose(tr("No response for %1 yet but %2 is at its connection"
+            " limit. Not sending a second request.").arg(episode->getName())
+            .arg(request.url().host()));
+        return;
+    }
+
+    verbose(tr("No response for %1 yet. Sending a second request to %2.")
+        .arg(episode->getName()).arg(request.url().toString()));
+
+    QString host = getHostKey(request.url());
+    m_hedgeHosts.insert(episode, host);
+    m_hostConnectionCount[host]++;
+    m_hedgeCount++;
+
+    episode->setHedgeReply(m_networkAccessManager->get(request));
+}
+
+void Client::episodeHedgeResolved(DownloadItem *item, bool hedgeWon)
+{
+    if (m_hedgeHosts.contains(item)) {
+        QString host = m_hedgeHosts.take(item);
+
+        m_hostConnectionCount[host]--;
+        if (m_hostConnectionCount.value(host) <= 0) {
+            m_hostConnectionCount.remove(host);
+        }
+    }
+
+    if (hedgeWon) {
+        m_hedgeWinCount++;
+        verbose(tr("The second request for %1 responded first.")
+            .arg(item->getName()));
+
+        // The second request may have gone to a different host.
+        acquireHost(item,
+            static_cast<PodcastEpisode *>(item)->getDownloadUrl());
+    }
+}
+
 void Client::episodeDownloaded(DownloadItem *item)
 {
     // item is really a PodcastEpisode object. The signal is set in the base
@@ -342,23 +660,232 @@ void Client::episodeDownloaded(DownloadItem *item)
     PodcastEpisode *episode = static_cast<PodcastEpisode *>(item);
 
     verbose(tr("Episode %1 downloaded successfully.").arg(episode->getName()));
+    if (!episode->getContentHash().isEmpty()) {
+        verbose(tr("Episode %1 is %2 bytes with %3 %4.")
+            .arg(episode->getName()).arg(episode->getFileSize())
+            .arg(episode->getHashAlgorithm()).arg(episode->getContentHash()));
+    }
 
-    m_database->setDownloaded(episode);
+    releaseHost(episode);
+    m_retryAttempts.remove(episode);
+    m_diskSpaceManager.release(episode);
+    m_activeSegmentCount -= episode->getSegmentCount();
+    m_activeDownloadCount--;
 
-    episode->deleteLater();
+    // With the batch policy episodes are synced together.
+    m_unpublishedEpisodes.append(episode);
+    if (m_settingsManager->getSyncPolicy() != "batch"
+        || m_unpublishedEpisodes.size()
+        >= m_settingsManager->getSyncBatchSize())
+    {
+        publishEpisodes();
+    }
 
-    m_activeDownloadCount--;
     downloadNext();
 }
 
+void Client::publishEpisodes()
+{
+    bool sync = m_settingsManager->getSyncPolicy() != "none";
+    QList<PodcastEpisode *> published;
+    QStringList directories;
+
+    // The data has to be on disk before the rename. Otherwise a crash can
+    // leave a file under the final name with missing data.
+    if (sync) {
+        Q_FOREACH (PodcastEpisode *episode, m_unpublishedEpisodes) {
+            if (episode->getLinkedFrom().isEmpty()) {
+                Platform::syncFile(episode->getPartialSaveLocation());
+            }
+        }
+    }
+
+    Q_FOREACH (PodcastEpisode *episode, m_unpublishedEpisodes) {
+        if (!episode->publish()) {
+            error(tr("Could not rename %1 to %2.")
+                .arg(episode->getPartialSaveLocation())
+                .arg(episode->getSaveLocation()), false);
+            episodeFailed(episode);
+            episode->deleteLater();
+            continue;
+        }
+
+        published.append(episode);
+        QString directory = QFileInfo(episode->getSaveLocation())
+            .absolutePath();
+        if (!directories.contains(directory)) {
+            directories.append(directory);
+        }
+    }
+    m_unpublishedEpisodes.clear();
+
+    // Make the renames durable before the episodes are recorded as
+    // downloaded.
+    if (sync) {
+        Q_FOREACH (QString directory, directories) {
+            Platform::syncDirectory(directory);
+        }
+    }
+
+    Q_FOREACH (PodcastEpisode *episode, published) {
+        // Store identical episodes once. The new file is replaced with a
+        // link to the one already on disk.
+        if (m_settingsManager->getDeduplicate()
+            && episode->getLinkedFrom().isEmpty())
+        {
+            Q_FOREACH (QString path, m_database->findDuplicates(episode)) {
+                // The file may have been changed, such as retagged, since
+                // it was recorded. Only link to it if it still has the
+                // content that was hashed.
+                if (QFileInfo(path).size() != episode->getFileSize()
+                    || ContentHash::hashFile(ContentHash::algorithmFromName(
+                    episode->getHashAlgorithm()), path)
+                    != episode->getContentHash())
+                {
+                    continue;
+                }
+
+                if (Platform::replaceWithHardLink(path,
+                    episode->getSaveLocation()))
+                {
+                    verbose(tr("Episode %1 is identical to %2. Linked to it.")
+                        .arg(episode->getName()).arg(path));
+                    break;
+                }
+            }
+        }
+
+        m_database->removePartial(episode);
+        m_database->setDownloaded(episode);
+
+        episode->deleteLater();
+    }
+}
+
+void Client::episodeHeadersReceived(DownloadItem *item)
+{
+    // item is really a PodcastEpisode object. The signal is set in the base
+    // class hence why there must be a cast to the derived class type.
+    PodcastEpisode *episode = static_cast<PodcastEpisode *>(item);
+
+    // Recent response times decide how long a request waits before a
+    // second one is sent.
+    if (episode->getResponseDelay() >= 0) {
+        m_responseDelays.append(episode->getResponseDelay());
+        if (m_responseDelays.size() > responseDelaySamples) {
+            m_responseDelays.removeFirst();
+        }
+    }
+
+    // An episode the server reports the same size and ETag for as one
+    // already on disk does not need to be downloaded again.
+    if (m_settingsManager->getDeduplicate()
+        && m_settingsManager->getDeduplicatePrecheck()
+        && episode->getContentLength() > 0)
+    {
+        Q_FOREACH (QString path, m_database->findByETag(
+            episode->getContentLength(), episode->getContentETag()))
+        {
+            if (QFileInfo(path).size() == episode->getContentLength()
+                && episode->linkExisting(path))
+            {
+                verbose(tr("Episode %1 matches %2. Linked to it without"
+                    " downloading.").arg(episode->getName()).arg(path));
+                episodeDownloaded(episode);
+                return;
+            }
+        }
+    }
+
+    // Record the partial download before any data is written so it can be
+    // resumed even if the application does not exit cleanly.
+    if (episode->getValidator().isEmpty()) {
+        m_database->removePartial(episode);
+    }
+    else {
+        m_database->setPartial(episode);
+    }
+
+    // The server knows the real size better than the rss feed. An episode
+    // that does not fit is stopped and waits for the other downloads to
+    // release their reservations. The partial file is kept so it can be
+    // resumed.
+    m_diskSpaceManager.reserve(episode, getExpectedSize(episode));
+    if (!m_diskSpaceManager.hasSpace(0)) {
+        m_deferredEpisodes.insert(episode);
+        episode->abort(tr("Not enough free space to download %1 bytes.")
+            .arg(getExpectedSize(episode)), DownloadItem::TransientFailure);
+        return;
+    }
+
+    // Use threads that would otherwise sit idle to download the rest of the
+    // episode in segments. The segments count against the connection limit
+    // of the host.
+    int segmentCount = qMin(m_settingsManager->getSegmentCount(),
+        m_settingsManager->getThreadCount() - m_activeDownloadCount
+        - m_activeSegmentCount + 1);
+    if (m_settingsManager->getHostConnectionLimit() > 0) {
+        segmentCount = qMin(segmentCount,
+            m_settingsManager->getHostConnectionLimit()
+            - m_hostConnectionCount.value(getHostKey(
+            episode->getDownloadUrl())) + 1);
+    }
+
+    if (segmentCount > 1 && episode->isRangeSupported()
+        && episode->getContentLength()
+        >= m_settingsManager->getSegmentMinimumSize() * 1024)
+    {
+        startEpisodeSegments(episode, segmentCount);
+    }
+}
+
+void Client::startEpisodeSegments(PodcastEpisode *episode, int segmentCount)
+{
+    qint64 length = episode->getContentLength();
+    qint64 segmentSize = length / segmentCount;
+
+    verbose(tr("Splitting episode download for %1 into %2 segments.")
+        .arg(episode->getName()).arg(segmentCount));
+
+    // The current download becomes the first segment.
+    episode->setSegmentEnd(segmentSize - 1);
+
+    for (int i = 1; i < segmentCount; i++) {
+        qint64 start = segmentSize * i;
+        qint64 end = start + segmentSize - 1;
+
+        // The last segment picks up the remainder of the division.
+        if (i == segmentCount - 1) {
+            end = length - 1;
+        }
+
+        QNetworkRequest request = getNetworkRequest();
+        request.setUrl(episode->getDownloadUrl());
+        request.setRawHeader("Range", QString("bytes=%1-%2").arg(start)
+            .arg(end).toAscii());
+        request.setRawHeader("If-Range", episode->getValidator().toAscii());
+
+        episode->addSegment(m_networkAccessManager->get(request), start, end);
+        m_activeSegmentCount++;
+        m_hostConnectionCount[m_activeHosts.value(episode)]++;
+    }
+}
+
 void Client::downloadItemNotModified(DownloadItem *item)
 {
+    m_notModifiedCount++;
     verbose(tr("%1 at %2 has not been modified since the last time it was"
         "downloaded.").arg(item->getName()).arg(item->getUrl().toString()));
 
+    releaseHost(item);
+    m_retryAttempts.remove(item);
+    m_knownEpisodeRuns.remove(item);
+    // Only rss feeds are downloaded conditionally.
+    saveMovedUrl(static_cast<Podcast *>(item));
     item->deleteLater();
 
     m_activeDownloadCount--;
+    m_activeRSSCount--;
     downloadNext();
 }
 
@@ -390,6 +917,7 @@ void Client::loadPodcasts()
     // Add the valid podcasts to the rss queue so their rss feeds can be
     // downloaded.
     Q_FOREACH (Podcast *podcast, podcastListingsParser.getPodcasts()) {
+        podcast->setMovedUrl(m_database->getMovedUrl(podcast));
         m_podcastRSSQueue.enqueue(podcast);
     }
 
@@ -401,6 +929,357 @@ void Client::loadPodcasts()
     }
 }
 
+void Client::loadBandwidthLimiter()
+{
+    m_bandwidthLimiter->setRate(m_settingsManager->getBandwidthLimit() * 1024);
+    m_bandwidthLimiter->setHostRate(m_settingsManager->getHostBandwidthLimit()
+        * 1024);
+    m_bandwidthLimiter->setWindow(m_settingsManager->getBandwidthLimitStart(),
+        m_settingsManager->getBandwidthLimitEnd());
+
+    if (m_settingsManager->getBandwidthLimit() > 0
+        || m_settingsManager->getHostBandwidthLimit() > 0)
+    {
+        verbose(tr("Limiting episode downloads to %1 KB/s total and %2 KB/s"
+            " per host (0 is unlimited).")
+            .arg(m_settingsManager->getBandwidthLimit())
+            .arg(m_settingsManager->getHostBandwidthLimit()));
+    }
+}
+
+void Client::setWatchdog(DownloadItem *item)
+{
+    item->setTimeouts(m_settingsManager->getConnectTimeout(),
+        m_settingsManager->getFirstByteTimeout(),
+        m_settingsManager->getIdleTimeout());
+
+    // A throttled episode is slow on purpose. Rss feeds are small enough
+    // that the rate says little about the server.
+    PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+    if (episode && m_settingsManager->getBandwidthLimit() == 0
+        && m_settingsManager->getHostBandwidthLimit() == 0)
+    {
+        item->setMinimumRate(
+            static_cast<qint64>(m_settingsManager->getMinimumRate()) * 1024,
+            m_settingsManager->getMinimumRateWindow());
+    }
+}
+
+int Client::getHedgeDelay()
+{
+    int percentile = m_settingsManager->getHedgePercentile();
+    if (percentile == 0) {
+        return 0;
+    }
+
+    // A few samples say little about the slow responses.
+    if (m_responseDelays.size() < hedgeMinimumSamples) {
+        return m_settingsManager->getHedgeDelay();
+    }
+
+    QList<int> delays = m_responseDelays;
+    qSort(delays);
+
+    return qMax(delays.at((delays.size() - 1) * percentile / 100),
+        m_settingsManager->getHedgeDelay());
+}
+
+void Client::loadDiskWriter()
+{
+    QString name = m_settingsManager->getWriteBackend().trimmed().toLower();
+    if (name == "none") {
+        return;
+    }
+
+    bool knownBackend;
+    WriteBackend *backend = WriteBackend::create(
+        WriteBackend::typeFromName(name, &knownBackend));
+    if (!knownBackend) {
+        error(tr("Unknown write backend %1. Using buffered.").arg(name),
+            false);
+    }
+    else if (!backend) {
+        // io_uring can be built in but refused when the ring is set up.
+        error(tr("Write backend %1 is not available on this system or could"
+            " not be set up. Using buffered.").arg(name), false);
+        backend = WriteBackend::create(WriteBackend::BufferedBackend);
+    }
+
+    m_diskWriter = new DiskWriter(backend);
+    m_diskWriter->start();
+
+    verbose(tr("Writing episodes with the %1 backend.")
+        .arg(m_diskWriter->getBackendName()));
+}
+
+bool Client::isRSSThreadAvailable()
+{
+    int threads = m_settingsManager->getThreadCount();
+    // Round up so any share reserves at least one thread.
+    int reserved = (threads * m_settingsManager->getEpisodeThreadShare()
+        + 99) / 100;
+
+    return m_activeRSSCount < threads - reserved;
+}
+
+int Client::findAvailablePodcast()
+{
+    for (int i = 0; i < m_podcastRSSQueue.size(); i++) {
+        if (isHostAvailable(getFeedUrl(m_podcastRSSQueue.at(i)))) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int Client::findAvailableEpisode()
+{
+    for (int i = 0; i < m_episodeQueue.size(); i++) {
+        PodcastEpisode *episode = m_episodeQueue.episodeAt(i);
+
+        if (isHostAvailable(episode->getUrl())
+            && m_diskSpaceManager.hasSpace(getExpectedSize(episode)))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+qint64 Client::getExpectedSize(PodcastEpisode *episode)
+{
+    if (episode->getContentLength() > 0) {
+        return episode->getContentLength();
+    }
+    if (episode->getEnclosureLength() > 0) {
+        return episode->getEnclosureLength();
+    }
+    return 0;
+}
+
+QString Client::getHostKey(const QUrl &url)
+{
+    return url.host().toLower();
+}
+
+bool Client::isHostAvailable(const QUrl &url)
+{
+    if (m_settingsManager->getHostConnectionLimit() <= 0) {
+        return true;
+    }
+
+    return m_hostConnectionCount.value(getHostKey(url))
+        < m_settingsManager->getHostConnectionLimit();
+}
+
+void Client::acquireHost(DownloadItem *item, const QUrl &url)
+{
+    // A redirected download moves its connection to the new host.
+    releaseHost(item);
+
+    QString host = getHostKey(url);
+    m_activeHosts.insert(item, host);
+    m_hostConnectionCount[host]++;
+}
+
+void Client::releaseHost(DownloadItem *item)
+{
+    if (!m_activeHosts.contains(item)) {
+        return;
+    }
+
+    QString host = m_activeHosts.take(item);
+    int connections = 1;
+
+    // Segments of an episode were counted against the same host.
+    PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+    if (episode) {
+        connections += episode->getSegmentCount();
+    }
+
+    m_hostConnectionCount[host] -= connections;
+    if (m_hostConnectionCount.value(host) <= 0) {
+        m_hostConnectionCount.remove(host);
+    }
+}
+
+QUrl Client::getFeedUrl(Podcast *podcast)
+{
+    QUrl movedUrl = podcast->getMovedUrl();
+
+    if (movedUrl.isValid() && !movedUrl.isEmpty()) {
+        return movedUrl;
+    }
+    return podcast->getUrl();
+}
+
+void Client::saveMovedUrl(Podcast *podcast)
+{
+    QUrl movedUrl = podcast->getPermanentUrl();
+
+    if (movedUrl.isEmpty() || movedUrl == podcast->getMovedUrl()) {
+        return;
+    }
+
+    verbose(tr("%1 has permanently moved to %2.").arg(podcast->getName())
+        .arg(movedUrl.toString()));
+    m_database->setMovedUrl(podcast, movedUrl);
+    podcast->setMovedUrl(movedUrl);
+}
+
+void Client::saveLastModified(Podcast *podcast)
+{
+    m_database->setLastModified(podcast);
+
+    if (m_failedFeeds.contains(podcast->getUrl().toString())) {
+        m_database->clearFeedHash(podcast->getUrl());
+    }
+}
+
+void Client::episodeFailed(PodcastEpisode *episode)
+{
+    // The feed's hash may already have been stored when the last of the
+    // podcast's episodes started. An unchanged feed would then keep the
+    // episode from being tried again.
+    m_failedFeeds.insert(episode->getPodcastUrl().toString());
+    m_database->clearFeedHash(episode->getPodcastUrl());
+}
+
+QString Client::getSaveLocation(Podcast *podcast, const QUrl &url)
+{
+    QDir fileDirectory(QString("%1/%2/%3")
+        .arg(m_settingsManager->getSaveLocation())
+        .arg(podcast->getCategory())
+        .arg(podcast->getName()));
+
+    return QString("%1/%2").arg(fileDirectory.absolutePath())
+        .arg(QFileInfo(url.toString()).fileName());
+}
+
+void Client::discardPartials(Podcast *podcast)
+{
+    QSet<QString> wanted;
+    Q_FOREACH (PodcastEpisode *episode, podcast->getEpisodes()) {
+        wanted.insert(episode->getUrl().toString());
+    }
+
+    Q_FOREACH (QString url, m_database->getPartialUrls(podcast)) {
+        if (!wanted.contains(url)) {
+            discardPartial(url, QString("%1.part")
+                .arg(getSaveLocation(podcast, QUrl(url))));
+        }
+    }
+}
+
+void Client::discardPartial(const QString &url, const QString &fileName)
+{
+    verbose(tr("Removing the partial download of %1.").arg(url));
+
+    QFile::remove(fileName);
+    m_database->removePartial(url);
+}
+
+bool Client::scheduleRetry(DownloadItem *item, const QString &errorString)
+{
+    if (item->getFailureType() == DownloadItem::PermanentFailure) {
+        return false;
+    }
+
+    // An episode that did not fit in the free space is started again as
+    // soon as it does. This is not counted as an attempt.
+    if (m_deferredEpisodes.remove(item)) {
+        m_retryQueue->schedule(item, 0);
+        verbose(tr("Could not download %1 because %2 Waiting for free"
+            " space.").arg(item->getName()).arg(errorString));
+        return true;
+    }
+
+    int attempt = m_retryAttempts.value(item) + 1;
+    if (attempt > m_settingsManager->getRetryCount()) {
+        return false;
+    }
+
+    qint64 maximumDelay = m_settingsManager->getRetryMaximumDelay() * 1000LL;
+    qint64 delay;
+
+    if (item->getRetryAfter() >= 0) {
+        // Waiting longer than the maximum would hold up every other
+        // download. Give up until the next run instead.
+        if (item->getRetryAfter() * 1000LL > maximumDelay) {
+            return false;
+        }
+        delay = item->getRetryAfter() * 1000LL;
+    }
+    else {
+        delay = m_settingsManager->getRetryDelay() * 1000LL;
+        for (int i = 1; i < attempt && delay < maximumDelay; i++) {
+            delay *= 2;
+        }
+        delay = qMin(delay, maximumDelay);
+        // Wait at least half of the delay.
+        delay = delay / 2 + qrand() % (delay / 2 + 1);
+    }
+
+    m_retryAttempts.insert(item, attempt);
+    m_retryQueue->schedule(item, static_cast<int>(delay));
+
+    verbose(tr("Could not download %1 because %2 Trying again in %3 seconds"
+        " (attempt %4 of %5).").arg(item->getName()).arg(errorString)
+        .arg(delay / 1000).arg(attempt)
+        .arg(m_settingsManager->getRetryCount()));
+
+    return true;
+}
+
+DownloadItem *Client::findAvailableRetry()
+{
+    Q_FOREACH (DownloadItem *item, m_retryQueue->getReadyItems()) {
+        QUrl url = item->getUrl();
+
+        Podcast *podcast = qobject_cast<Podcast *>(item);
+        if (podcast) {
+            url = getFeedUrl(podcast);
+        }
+
+        // Episodes wait for disk space the same as queued episodes.
+        PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+        if (episode
+            && !m_diskSpaceManager.hasSpace(getExpectedSize(episode)))
+        {
+            continue;
+        }
+
+        if (isHostAvailable(url)) {
+            return item;
+        }
+    }
+
+    return 0;
+}
+
+void Client::startRetry(DownloadItem *item)
+{
+    m_retryQueue->remove(item);
+    m_activeDownloadCount++;
+
+    // The redirects will be followed again starting from the original url.
+    item->clearRedirects();
+
+    PodcastEpisode *episode = qobject_cast<PodcastEpisode *>(item);
+    if (episode) {
+        // The partial file was closed when the download failed.
+        episode->setSaveLocation(episode->getSaveLocation());
+        m_diskSpaceManager.reserve(episode, getExpectedSize(episode));
+        startEpisodeDownload(episode, episode->getUrl());
+    }
+    else {
+        m_activeRSSCount++;
+        startRSSDownload(item, getFeedUrl(static_cast<Podcast *>(item)));
+    }
+}
+
 QNetworkRequest Client::getNetworkRequest()
 {
     QNetworkRequest request;
@@ -412,6 +1291,39 @@ QNetworkRequest Client::getNetworkRequest()
     return request;
 }
 
+void Client::summary()
+{
+    verbose(tr("Rss feeds transferred %1 bytes, decoded to %2 bytes.")
+        .arg(m_feedTransferredBytes).arg(m_feedDecodedBytes));
+
+    verbose(tr("%1 rss feeds were not modified. %2 of them were sent in"
+        " full but had not changed.").arg(m_notModifiedCount)
+        .arg(m_unchangedFeedCount));
+
+    if (m_bufferPool) {
+        verbose(tr("Read buffers used %1 KB.")
+            .arg(m_bufferPool->getAllocatedSize() / 1024));
+    }
+    if (m_diskWriter) {
+        verbose(tr("Disk writer did %1 writes with the %2 backend. Average"
+            " latency %3 us, maximum latency %4 us, maximum queue depth %5.")
+            .arg(m_diskWriter->getWriteCount())
+            .arg(m_diskWriter->getBackendName())
+            .arg(m_diskWriter->getAverageLatency())
+            .arg(m_diskWriter->getMaximumLatency())
+            .arg(m_diskWriter->getMaximumQueueDepth()));
+    }
+    if (m_hedgeCount > 0) {
+        verbose(tr("Sent %1 second requests for slow episode responses. The"
+            " second request responded first %2 times.").arg(m_hedgeCount)
+            .arg(m_hedgeWinCount));
+    }
+    if (Platform::getPeakMemoryUsage() >= 0) {
+        verbose(tr("Peak memory use was %1 KB.")
+            .arg(Platform::getPeakMemoryUsage()));
+    }
+}
+
 void Client::verbose(const QString &message)
 {
     if (m_verboseMode) {
@@ -437,11 +1349,24 @@ void Client::parseOptions()
     OptsOption filterExplicitOption(tr("filter_explicit"), &filterExplicit,
         false, 0, tr("Do not download episodes marked as explicit"), "");
 
+    bool syncSet = false;
+    QString syncArg = "";
+    OptsOption syncOption(tr("sync"), &syncSet, true, &syncArg,
+        tr("When completed episodes are forced to disk before being moved"
+        " into place. file syncs each episode. batch syncs several at once."
+        " none leaves it to the system."), tr("POLICY"));
+
+    bool dedupPrecheck = false;
+    OptsOption dedupPrecheckOption(tr("dedup_precheck"), &dedupPrecheck,
+        false, 0, tr("Do not download episodes whose size and ETag match an"
+        " episode already downloaded. Link to the existing file instead."),
+        "");
+
     bool ignoreNotModified = false;
     OptsOption ignoreNotModifiedOption(tr("ignore_not_modified"),
         &ignoreNotModified, false, 0, tr("Do a full download of all rss"
-        " feeds. Do not rely on the last modified time the server reports to"
-        " determine if there are no new episodes."), "");
+        " feeds. Do not rely on the last modified time or ETag the server"
+        " reports to determine if there are no new episodes."), "");
 
     bool episodesdbSet = false;
     QString episodesdbArg = "";
@@ -454,17 +1379,112 @@ void Client::parseOptions()
         &saveLocationArg, tr("The locaction to save downloaded episodes."),
         tr("PATH"));
 
+    bool segmentsSet = false;
+    QString segmentsArg = "";
+    OptsOption segmentsOption(tr("segments"), &segmentsSet, true,
+        &segmentsArg, tr("Maximum number of simultaneous connections used to"
+        " download a single large episode. Only threads that would otherwise"
+        " be idle are used."), tr("NUMBER"));
+
+    bool hostConnectionsSet = false;
+    QString hostConnectionsArg = "";
+    OptsOption hostConnectionsOption(tr("host_connections"),
+        &hostConnectionsSet, true, &hostConnectionsArg, tr("Maximum number of"
+        " simultaneous downloads from a single host. 0 for no limit."),
+        tr("NUMBER"));
+
+    bool bandwidthSet = false;
+    QString bandwidthArg = "";
+    OptsOption bandwidthOption(tr("bandwidth_limit"), &bandwidthSet, true,
+        &bandwidthArg, tr("Maximum total download rate in KB per second. 0"
+        " for no limit."), tr("NUMBER"));
+
+    bool hostBandwidthSet = false;
+    QString hostBandwidthArg = "";
+    OptsOption hostBandwidthOption(tr("host_bandwidth_limit"),
+        &hostBandwidthSet, true, &hostBandwidthArg, tr("Maximum download rate"
+        " from a single host in KB per second. 0 for no limit."),
+        tr("NUMBER"));
+
+    bool bandwidthWindowSet = false;
+    QString bandwidthWindowArg = "";
+    OptsOption bandwidthWindowOption(tr("bandwidth_limit_window"),
+        &bandwidthWindowSet, true, &bandwidthWindowArg, tr("Time of day the"
+        " bandwidth limits apply. For example 08:00-18:00. Outside of the"
+        " window downloads run at full speed."), tr("HH:mm-HH:mm"));
+
+    bool retriesSet = false;
+    QString retriesArg = "";
+    OptsOption retriesOption(tr("retries"), &retriesSet, true, &retriesArg,
+        tr("Number of times a download that failed because of a network or"
+        " server problem is tried again. 0 to never retry."), tr("NUMBER"));
+
+    bool idleTimeoutSet = false;
+    QString idleTimeoutArg = "";
+    OptsOption idleTimeoutOption(tr("idle_timeout"), &idleTimeoutSet, true,
+        &idleTimeoutArg, tr("Seconds a download can go without receiving"
+        " data before it is stopped and tried again. 0 for no limit."),
+        tr("NUMBER"));
+
+    bool minRateSet = false;
+    QString minRateArg = "";
+    OptsOption minRateOption(tr("min_rate"), &minRateSet, true, &minRateArg,
+        tr("Slowest rate in KB per second an episode can download at before"
+        " it is stopped and tried again. 0 for no limit."), tr("NUMBER"));
+
+    bool hedgeSet = false;
+    QString hedgeArg = "";
+    OptsOption hedgeOption(tr("hedge"), &hedgeSet, true, &hedgeArg,
+        tr("Percentile of recent response times an episode request can wait"
+        " for before a second request is sent and the first to respond is"
+        " used. 0 to never send a second request."), tr("NUMBER"));
+
     bool threadsSet = false;
     QString threadsArg = "";
     OptsOption threadsOption(tr("threads"), &threadsSet, true, &threadsArg,
         tr("Number of simultaneous downloads."), tr("NUMBER"));
 
+    bool episodeShareSet = false;
+    QString episodeShareArg = "";
+    OptsOption episodeShareOption(tr("episode_share"), &episodeShareSet,
+        true, &episodeShareArg, tr("Percent of the threads reserved for"
+        " episodes once there are episodes to download. 0 to download every"
+        " rss feed first."), tr("NUMBER"));
+
+    bool episodeOrderSet = false;
+    QString episodeOrderArg = "";
+    OptsOption episodeOrderOption(tr("episode_order"), &episodeOrderSet, true,
+        &episodeOrderArg, tr("Order episodes are downloaded in. round_robin"
+        " takes one episode from each podcast in turn. newest takes the most"
+        " recently published episodes first. shortest takes the smallest"
+        " episodes first."), tr("ORDER"));
+
+    bool writeBackendSet = false;
+    QString writeBackendArg = "";
+    OptsOption writeBackendOption(tr("write_backend"), &writeBackendSet,
+        true, &writeBackendArg, tr("How episodes are written to disk."
+        " buffered, direct or io_uring write from a separate thread. none"
+        " writes as data arrives."), tr("BACKEND"));
+
+    bool hashSet = false;
+    QString hashArg = "";
+    OptsOption hashOption(tr("hash"), &hashSet, true, &hashArg,
+        tr("Algorithm downloaded episodes are hashed with. sha256, sha1, md5"
+        " or none."), tr("ALGORITHM"));
+
     bool recentSet = false;
     QString recentArg = "";
     OptsOption recentOption(tr("recent"), &recentSet, true, &recentArg,
         tr("Maximum number of recent episodes to download. 0 for all recent "
         "episodes."), tr("NUMBER"));
 
+    bool stopAfterKnownSet = false;
+    QString stopAfterKnownArg = "";
+    OptsOption stopAfterKnownOption(tr("stop_after_known"),
+        &stopAfterKnownSet, true, &stopAfterKnownArg, tr("Stop reading an"
+        " rss feed after this many episodes in a row that have already been"
+        " downloaded. 0 to read the whole feed."), tr("NUMBER"));
+
     bool minFreeSet = false;
     QString minFreeArg = "";
     OptsOption minFreeOption(tr("min_free_space"), &minFreeSet, true,
@@ -482,11 +1502,27 @@ void Client::parseOptions()
     opts.addOption(verboseOption);
     opts.addOption(writeConfigOption);
     opts.addOption(filterExplicitOption);
+    opts.addOption(dedupPrecheckOption);
     opts.addOption(ignoreNotModifiedOption);
     opts.addOption(episodesdbOption);
     opts.addOption(saveLocationOption);
     opts.addOption(threadsOption);
+    opts.addOption(segmentsOption);
+    opts.addOption(hostConnectionsOption);
+    opts.addOption(bandwidthOption);
+    opts.addOption(hostBandwidthOption);
+    opts.addOption(bandwidthWindowOption);
+    opts.addOption(retriesOption);
+    opts.addOption(idleTimeoutOption);
+    opts.addOption(minRateOption);
+    opts.addOption(hedgeOption);
+    opts.addOption(episodeShareOption);
+    opts.addOption(episodeOrderOption);
+    opts.addOption(writeBackendOption);
+    opts.addOption(hashOption);
+    opts.addOption(syncOption);
     opts.addOption(recentOption);
+    opts.addOption(stopAfterKnownOption);
     opts.addOption(minFreeOption);
     opts.addOption(listingOption);
 
@@ -501,6 +1537,9 @@ void Client::parseOptions()
     if (filterExplicit) {
         m_settingsManager->setFilterExplicit(true);
     }
+    if (dedupPrecheck) {
+        m_settingsManager->setDeduplicatePrecheck(true);
+    }
     if (ignoreNotModified) {
         m_settingsManager->setIgnoreNotModified(true);
     }
@@ -513,9 +1552,55 @@ void Client::parseOptions()
     if (threadsSet) {
         m_settingsManager->setThreadCount(threadsArg.toInt());
     }
+    if (hostConnectionsSet) {
+        m_settingsManager->setHostConnectionLimit(hostConnectionsArg.toInt());
+    }
+    if (bandwidthSet) {
+        m_settingsManager->setBandwidthLimit(bandwidthArg.toLongLong());
+    }
+    if (hostBandwidthSet) {
+        m_settingsManager->setHostBandwidthLimit(
+            hostBandwidthArg.toLongLong());
+    }
+    if (bandwidthWindowSet) {
+        m_settingsManager->setBandwidthLimitWindow(bandwidthWindowArg);
+    }
+    if (segmentsSet) {
+        m_settingsManager->setSegmentCount(segmentsArg.toInt());
+    }
+    if (retriesSet) {
+        m_settingsManager->setRetryCount(retriesArg.toInt());
+    }
+    if (idleTimeoutSet) {
+        m_settingsManager->setIdleTimeout(idleTimeoutArg.toInt());
+    }
+    if (minRateSet) {
+        m_settingsManager->setMinimumRate(minRateArg.toInt());
+    }
+    if (hedgeSet) {
+        m_settingsManager->setHedgePercentile(hedgeArg.toInt());
+    }
+    if (episodeShareSet) {
+        m_settingsManager->setEpisodeThreadShare(episodeShareArg.toInt());
+    }
+    if (episodeOrderSet) {
+        m_settingsManager->setEpisodeOrder(episodeOrderArg);
+    }
+    if (writeBackendSet) {
+        m_settingsManager->setWriteBackend(writeBackendArg);
+    }
+    if (syncSet) {
+        m_settingsManager->setSyncPolicy(syncArg);
+    }
+    if (hashSet) {
+        m_settingsManager->setHashAlgorithm(hashArg);
+    }
     if (recentSet) {
         m_settingsManager->setRecentEpisodeCount(recentArg.toInt());
     }
+    if (stopAfterKnownSet) {
+        m_settingsManager->setStopAfterKnown(stopAfterKnownArg.toInt());
+    }
     if (minFreeSet) {
         m_settingsManager->setMinimumFreeDiskSpace(minFreeArg.toLongLong());
     }
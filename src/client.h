@@ -22,15 +22,24 @@
 #define CLIENT_H
 
 #include <QByteArray>
+#include <QHash>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QObject>
 #include <QQueue>
+#include <QSet>
 #include <QTextStream>
 
+#include "bandwidthlimiter.h"
+#include "bufferpool.h"
+#include "contenthash.h"
 #include "database.h"
+#include "diskspacemanager.h"
+#include "diskwriter.h"
+#include "episodequeue.h"
 #include "podcast.h"
 #include "podcastepisode.h"
+#include "retryqueue.h"
 #include "settingsmanager.h"
 
 /**
@@ -63,6 +72,9 @@ class Client : public QObject
         /**
          * Writes the error associated with the download to stderr.
          *
+         * Downloads that failed because of a network or server problem are
+         * scheduled to be tried again instead.
+         *
          * Will start the next download.
          *
          * @see downloadNext
@@ -102,12 +114,25 @@ class Client : public QObject
          * object.
          *
          * Checks for new episodes and on user settings adds them to
-         * m_podcastDownloadQueue. If the podcast is set to init mode all new
+         * m_episodeQueue. If the podcast is set to init mode all new
          * episodes will be marked as downloaded.
          *
          * @param item The Podcast to use for generating a list of episodes.
          */
         void episodesReady(DownloadItem *item);
+        /**
+         * An episode has been parsed from a podcast's rss feed.
+         *
+         * This slot should only be linked to a singal sending a Podcast
+         * object.
+         *
+         * Stops reading the feed once enough episodes in a row have already
+         * been downloaded or the recent episode count has been read.
+         *
+         * @param item The Podcast whose feed is being read.
+         * @param episode The episode.
+         */
+        void episodeParsed(DownloadItem *item, PodcastEpisode *episode);
 
         /**
          * Download a podcast episode.
@@ -115,27 +140,66 @@ class Client : public QObject
          * This slot should only be linked to a singal sending a PodcastEpisode
          * object.
          *
-         * Either an episode will be taken from m_podcastDownloadQueue or one
-         * can be given. If one is given it is because of a 301 or 302 content
-         * moved response from the episode download.
+         * Used for episodes that have already been started. Either because
+         * of a 301 or 302 content moved response from the episode download
+         * or because the download is being tried again.
+         *
+         * @param item The PodcastEpisode to use.
+         * @param url The url to download the episode from.
          *
-         * @param item An optional PodcastEpisode to use. If one is not given
-         * a PodcastEpisode will be taken from m_podcastDownloadQueue.
-         * @param url An optional url to download the episode from. If this is
-         * not given the PodcastEpisode url will be used.
+         * @see startQueuedEpisode
          */
-        void startEpisodeDownload(DownloadItem *item=0, QUrl url=QUrl());
+        void startEpisodeDownload(DownloadItem *item, QUrl url);
         /**
          * The podcast episode has been successfully downloaded.
          *
          * This slot should only be linked to a singal sending a PodcastEpisode
          * object.
          *
-         * Sets the episode as downloaded and starts the next download.
+         * Queues the episode to be published and starts the next download.
          *
          * @param item The PodcastEpisode that has been downloaded.
+         *
+         * @see publishEpisodes
          */
         void episodeDownloaded(DownloadItem *item);
+        /**
+         * The server has started sending the podcast episode.
+         *
+         * This slot should only be linked to a singal sending a PodcastEpisode
+         * object.
+         *
+         * Records the partial download in the database so it can be resumed
+         * if it does not complete.
+         *
+         * @param item The PodcastEpisode that is being downloaded.
+         */
+        void episodeHeadersReceived(DownloadItem *item);
+        /**
+         * An episode request has not responded within the hedge delay.
+         *
+         * This slot should only be linked to a singal sending a PodcastEpisode
+         * object.
+         *
+         * Sends a second request for the episode. Whichever responds first
+         * is used.
+         *
+         * @param item The PodcastEpisode that is waiting on the server.
+         *
+         * @see getHedgeDelay
+         */
+        void startEpisodeHedge(DownloadItem *item);
+        /**
+         * The first of an episode's two requests has responded and the other
+         * has been cancelled.
+         *
+         * This slot should only be linked to a singal sending a PodcastEpisode
+         * object.
+         *
+         * @param item The PodcastEpisode.
+         * @param hedgeWon True if the second request responded first.
+         */
+        void episodeHedgeResolved(DownloadItem *item, bool hedgeWon);
 
         /**
          * The download item has not been modified since the last time it was
@@ -159,6 +223,208 @@ class Client : public QObject
          * rss feeds can be checked for new episodes.
          */
         void loadPodcasts();
+        /**
+         * Set up the bandwidth limiter from the user settings.
+         */
+        void loadBandwidthLimiter();
+        /**
+         * Start the disk writer thread with the backend from the user
+         * settings.
+         */
+        void loadDiskWriter();
+        /**
+         * Set the timeouts and minimum rate of a download from the user
+         * settings.
+         *
+         * @param item The download.
+         */
+        void setWatchdog(DownloadItem *item);
+        /**
+         * Gets how long an episode request waits for a response before a
+         * second request is sent.
+         *
+         * This is the hedge percentile of the recent response times but
+         * never less than the hedge delay setting.
+         *
+         * @return The delay in milliseconds. 0 if second requests are not
+         * sent.
+         */
+        int getHedgeDelay();
+        /**
+         * Move the downloaded episodes into place and set them as
+         * downloaded.
+         *
+         * The partial files are synced to disk first and their directories
+         * after the rename as the sync policy requires. Episodes are only
+         * set as downloaded in the database once they are in place.
+         */
+        void publishEpisodes();
+        /**
+         * Can another rss feed start without using a thread reserved for
+         * episodes.
+         *
+         * @return True if the active rss downloads are below their share of
+         * the threads.
+         */
+        bool isRSSThreadAvailable();
+        /**
+         * Find the first podcast in m_podcastRSSQueue whose rss feed can be
+         * downloaded without going over the connection limit of its host.
+         *
+         * @return The index of the podcast in the queue. -1 if every podcast
+         * is waiting on a busy host.
+         */
+        int findAvailablePodcast();
+        /**
+         * Find the first episode in m_episodeQueue that can be downloaded
+         * without going over the connection limit of its host.
+         *
+         * @return The index of the episode in the queue. -1 if every episode
+         * is waiting on a busy host.
+         */
+        int findAvailableEpisode();
+        /**
+         * Gets the size an episode download is expected to be.
+         *
+         * @param episode The episode.
+         *
+         * @return The content length reported by the server or the length
+         * listed in the rss feed in bytes. 0 if neither is known.
+         */
+        qint64 getExpectedSize(PodcastEpisode *episode);
+        /**
+         * Start downloading an episode from m_episodeQueue.
+         *
+         * Creates the directory the episode is saved in and connects the
+         * episode's signals.
+         *
+         * @param index The position of the episode in m_episodeQueue.
+         */
+        void startQueuedEpisode(int index);
+        /**
+         * Gets the name used to count connections to the host of a url.
+         *
+         * @param url The url.
+         *
+         * @return The host key.
+         */
+        QString getHostKey(const QUrl &url);
+        /**
+         * Can another connection be made to the host of the url.
+         *
+         * @param url The url to download.
+         *
+         * @return True if the host is under its connection limit.
+         */
+        bool isHostAvailable(const QUrl &url);
+        /**
+         * Count a download against the host it is downloading from.
+         *
+         * If the item was already counted against a host, because the
+         * content moved, it is moved to the new host.
+         *
+         * @param item The item being downloaded.
+         * @param url The url the item is being downloaded from.
+         */
+        void acquireHost(DownloadItem *item, const QUrl &url);
+        /**
+         * Stop counting a download, and any of its segments, against its
+         * host.
+         *
+         * @param item The item that is no longer downloading.
+         */
+        void releaseHost(DownloadItem *item);
+        /**
+         * Gets the url a podcast's rss feed should be downloaded from.
+         *
+         * @param podcast The podcast.
+         *
+         * @return The url the feed permanently moved to on a previous run.
+         * Otherwise, the url from the podcast listings file.
+         */
+        QUrl getFeedUrl(Podcast *podcast);
+        /**
+         * Remember the url a podcast's rss feed permanently moved to so the
+         * redirect can be skipped next time.
+         *
+         * @param podcast The podcast that was downloaded.
+         */
+        void saveMovedUrl(Podcast *podcast);
+        /**
+         * Store the last modified date, ETag and hash of a podcast's rss
+         * feed.
+         *
+         * The hash is not kept for a podcast with an episode that failed so
+         * the feed is parsed again next time and the episode is retried.
+         *
+         * @param podcast The podcast.
+         */
+        void saveLastModified(Podcast *podcast);
+        /**
+         * Record that an episode could not be downloaded this run.
+         *
+         * @param episode The episode.
+         */
+        void episodeFailed(PodcastEpisode *episode);
+        /**
+         * Gets where an episode of a podcast is saved.
+         *
+         * @param podcast The podcast.
+         * @param url The url of the episode.
+         *
+         * @return The file name including path.
+         */
+        QString getSaveLocation(Podcast *podcast, const QUrl &url);
+        /**
+         * Remove the partial downloads of a podcast's episodes that will
+         * not be downloaded.
+         *
+         * These are episodes that left the feed, are past the recent
+         * episode count or are filtered. Their records would otherwise keep
+         * the feed from being requested conditionally.
+         *
+         * @param podcast The podcast. Its episode list holds the episodes
+         * that will be downloaded.
+         */
+        void discardPartials(Podcast *podcast);
+        /**
+         * Remove the partial download of an episode.
+         *
+         * @param url The url of the episode.
+         * @param fileName The partial file.
+         */
+        void discardPartial(const QString &url, const QString &fileName);
+        /**
+         * Schedule a failed download to be tried again.
+         *
+         * The delay doubles with each attempt up to the maximum retry delay.
+         * A random part is added so downloads that failed together are not
+         * all tried again at the same time. A Retry-After time sent by the
+         * server is used instead when there is one.
+         *
+         * @param item The download that failed.
+         * @param errorString Why it failed.
+         *
+         * @return True if the download will be tried again. False if the
+         * failure is permanent or the retries have been used up.
+         */
+        bool scheduleRetry(DownloadItem *item, const QString &errorString);
+        /**
+         * Find a download that is ready to be tried again.
+         *
+         * @return A download whose host is not at its connection limit. 0
+         * if there is none.
+         */
+        DownloadItem *findAvailableRetry();
+        /**
+         * Try a failed download again.
+         *
+         * The item is taken from m_retryQueue. It is still connected to the
+         * client from the first attempt.
+         *
+         * @param item The download to try again.
+         */
+        void startRetry(DownloadItem *item);
         /**
          * Gets a network request object and populates it with necessary
          * headers.
@@ -166,6 +432,21 @@ class Client : public QObject
          * @return A network requeset.
          */
         QNetworkRequest getNetworkRequest();
+        /**
+         * Split the rest of an episode download into segments that are
+         * downloaded in parallel.
+         *
+         * @param episode The episode being downloaded.
+         * @param segmentCount The total number of segments including the
+         * current download.
+         */
+        void startEpisodeSegments(PodcastEpisode *episode, int segmentCount);
+        /**
+         * Write statistics about the run in verbose mode.
+         *
+         * Called before the application exits.
+         */
+        void summary();
         /**
          * Check and write message for verbose mode.
          */
@@ -210,11 +491,108 @@ class Client : public QObject
          * Starts downloads of DownloadItems.
          */
         QNetworkAccessManager *m_networkAccessManager;
+        /**
+         * Throttles episode downloads.
+         */
+        BandwidthLimiter *m_bandwidthLimiter;
         /**
          * The number of currently downloading objects. When this reaches 0
          * the application will exit.
          */
         int m_activeDownloadCount;
+        /**
+         * The number of rss feeds currently downloading. Included in
+         * m_activeDownloadCount.
+         */
+        int m_activeRSSCount;
+        /**
+         * The number of additional connections used to download segments of
+         * episodes. These count against the thread count.
+         */
+        int m_activeSegmentCount;
+
+        /**
+         * The number of active connections to each host.
+         */
+        QHash<QString, int> m_hostConnectionCount;
+        /**
+         * The host each active download is counted against.
+         */
+        QHash<DownloadItem *, QString> m_activeHosts;
+        /**
+         * The host each outstanding second request is counted against.
+         */
+        QHash<DownloadItem *, QString> m_hedgeHosts;
+        /**
+         * How long recent episode requests took to respond in milliseconds.
+         */
+        QList<int> m_responseDelays;
+        /**
+         * The number of second requests sent.
+         */
+        int m_hedgeCount;
+        /**
+         * The number of second requests that responded first.
+         */
+        int m_hedgeWinCount;
+        /**
+         * Buffers episode data is read into.
+         */
+        BufferPool *m_bufferPool;
+        /**
+         * Writes episode data to disk. 0 when episodes write from the main
+         * thread.
+         */
+        DiskWriter *m_diskWriter;
+        /**
+         * The algorithm downloaded episodes are hashed with.
+         */
+        ContentHash::Algorithm m_hashAlgorithm;
+        /**
+         * Failed downloads waiting to be tried again.
+         */
+        RetryQueue *m_retryQueue;
+        /**
+         * The number of times each download has been tried again.
+         */
+        QHash<DownloadItem *, int> m_retryAttempts;
+        /**
+         * The number of episodes in a row already downloaded at the point
+         * each rss feed has been read to.
+         */
+        QHash<DownloadItem *, int> m_knownEpisodeRuns;
+        /**
+         * The urls of podcasts with an episode that could not be downloaded
+         * this run.
+         */
+        QSet<QString> m_failedFeeds;
+        /**
+         * Episodes stopped because they did not fit in the free space. They
+         * are retried without a delay once they fit.
+         */
+        QSet<DownloadItem *> m_deferredEpisodes;
+        /**
+         * Downloaded episodes waiting to be synced and moved into place.
+         */
+        QList<PodcastEpisode *> m_unpublishedEpisodes;
+
+        /**
+         * The number of bytes transferred for all rss feeds.
+         */
+        qint64 m_feedTransferredBytes;
+        /**
+         * The size of all rss feeds after they were decompressed.
+         */
+        qint64 m_feedDecodedBytes;
+        /**
+         * The number of rss feeds the server reported as not modified.
+         */
+        int m_notModifiedCount;
+        /**
+         * The number of rss feeds that were sent in full but had not
+         * changed since the last download.
+         */
+        int m_unchangedFeedCount;
 
         /**
          * Holds the settings used by the application.
@@ -226,9 +604,32 @@ class Client : public QObject
          */
         QQueue<Podcast *> m_podcastRSSQueue;
         /**
-         * Podcasts that have episodes that are waiting to be downloaded.
+         * Episodes that are waiting to be downloaded.
+         */
+        EpisodeQueue m_episodeQueue;
+        /**
+         * The disk space reserved by running episode downloads.
+         */
+        DiskSpaceManager m_diskSpaceManager;
+
+        /**
+         * The size of each buffer in m_bufferPool in bytes.
+         */
+        static const int readChunkSize;
+        /**
+         * The number of buffers per thread when a disk writer is used. The
+         * extra buffers are waiting in the writer's queue.
+         */
+        static const int writerBuffersPerThread;
+        /**
+         * The number of recent response times kept.
+         */
+        static const int responseDelaySamples;
+        /**
+         * The number of response times needed before the percentile is
+         * used.
          */
-        QQueue<Podcast *> m_podcastDownloadQueue;
+        static const int hedgeMinimumSamples;
 };
 
 #endif /* CLIENT_H */
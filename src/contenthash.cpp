@@ -0,0 +1,160 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <QFile>
+
+#include "contenthash.h"
+
+ContentHash::ContentHash(Algorithm algorithm)
+{
+    m_algorithm = algorithm;
+    m_sha256 = 0;
+    m_qtHash = 0;
+
+    switch (m_algorithm) {
+        case Sha256Hash:
+            m_sha256 = new Sha256();
+            break;
+        case Sha1Hash:
+            m_qtHash = new QCryptographicHash(QCryptographicHash::Sha1);
+            break;
+        case Md5Hash:
+            m_qtHash = new QCryptographicHash(QCryptographicHash::Md5);
+            break;
+        case NoHash:
+        default:
+            break;
+    }
+}
+
+ContentHash::~ContentHash()
+{
+    delete m_sha256;
+    delete m_qtHash;
+}
+
+ContentHash::Algorithm ContentHash::algorithmFromName(const QString &name,
+    bool *ok)
+{
+    QString algorithm = name.trimmed().toLower();
+
+    if (ok) {
+        *ok = true;
+    }
+
+    if (algorithm == "none") {
+        return NoHash;
+    }
+    else if (algorithm == "sha1") {
+        return Sha1Hash;
+    }
+    else if (algorithm == "md5") {
+        return Md5Hash;
+    }
+    else if (algorithm != "sha256" && ok) {
+        *ok = false;
+    }
+
+    return Sha256Hash;
+}
+
+QString ContentHash::algorithmName(Algorithm algorithm)
+{
+    switch (algorithm) {
+        case Sha256Hash:
+            return "sha256";
+        case Sha1Hash:
+            return "sha1";
+        case Md5Hash:
+            return "md5";
+        case NoHash:
+        default:
+            return "";
+    }
+}
+
+QString ContentHash::hashFile(Algorithm algorithm, const QString &fileName)
+{
+    if (algorithm == NoHash) {
+        return QString();
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    ContentHash hash(algorithm);
+    QByteArray buffer(65536, 0);
+    qint64 count;
+
+    while ((count = file.read(buffer.data(), buffer.size())) > 0) {
+        hash.addData(buffer.constData(), count);
+    }
+    if (count < 0) {
+        return QString();
+    }
+
+    return hash.result();
+}
+
+ContentHash::Algorithm ContentHash::getAlgorithm() const
+{
+    return m_algorithm;
+}
+
+void ContentHash::reset()
+{
+    if (m_sha256) {
+        m_sha256->reset();
+    }
+    if (m_qtHash) {
+        m_qtHash->reset();
+    }
+}
+
+void ContentHash::addData(const char *data, qint64 length)
+{
+    // The hashes take an int length.
+    while (length > 0) {
+        int count = static_cast<int>(qMin(length, Q_INT64_C(1073741824)));
+
+        if (m_sha256) {
+            m_sha256->addData(data, count);
+        }
+        if (m_qtHash) {
+            m_qtHash->addData(data, count);
+        }
+
+        data += count;
+        length -= count;
+    }
+}
+
+QString ContentHash::result() const
+{
+    if (m_sha256) {
+        return QString::fromAscii(m_sha256->result().toHex());
+    }
+    if (m_qtHash) {
+        return QString::fromAscii(m_qtHash->result().toHex());
+    }
+    return QString();
+}
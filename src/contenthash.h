@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+
+#include "sha256.h"
+
+/**
+ * Hashes the content of a downloaded episode with a selectable algorithm.
+ */
+class ContentHash
+{
+    public:
+        /**
+         * The available algorithms.
+         */
+        enum Algorithm {
+            /**
+             * Nothing is hashed.
+             */
+            NoHash,
+            Sha256Hash,
+            /**
+             * Faster than SHA-256.
+             */
+            Sha1Hash,
+            /**
+             * The fastest. Only suitable for detecting corruption.
+             */
+            Md5Hash
+        };
+
+        /**
+         * @param algorithm The algorithm to hash with.
+         */
+        ContentHash(Algorithm algorithm);
+        ~ContentHash();
+
+        /**
+         * Gets the algorithm for a name.
+         *
+         * @param name One of sha256, sha1, md5 or none.
+         * @param ok Set to false if the name is not known.
+         *
+         * @return The algorithm. Sha256Hash if the name is not known.
+         */
+        static Algorithm algorithmFromName(const QString &name, bool *ok=0);
+        /**
+         * Gets the name of an algorithm.
+         *
+         * @param algorithm The algorithm.
+         *
+         * @return The name. An empty string for NoHash.
+         */
+        static QString algorithmName(Algorithm algorithm);
+        /**
+         * Hashes the content of a file.
+         *
+         * @param algorithm The algorithm to hash with.
+         * @param fileName The file name including path.
+         *
+         * @return The hash as lower case hex. An empty string if the file
+         * could not be read or for NoHash.
+         */
+        static QString hashFile(Algorithm algorithm,
+            const QString &fileName);
+
+        /**
+         * Gets the algorithm being used.
+         *
+         * @return The algorithm.
+         */
+        Algorithm getAlgorithm() const;
+        /**
+         * Start a new hash discarding any data added so far.
+         */
+        void reset();
+        /**
+         * Add data to the hash.
+         *
+         * @param data The data.
+         * @param length The number of bytes.
+         */
+        void addData(const char *data, qint64 length);
+        /**
+         * Gets the hash of the data added so far.
+         *
+         * @return The hash as lower case hex. An empty string for NoHash.
+         */
+        QString result() const;
+
+    private:
+        /**
+         * The algorithm being used.
+         */
+        Algorithm m_algorithm;
+        /**
+         * Used for SHA-256.
+         */
+        Sha256 *m_sha256;
+        /**
+         * Used for the algorithms provided by Qt.
+         */
+        QCryptographicHash *m_qtHash;
+};
+
+#endif /* CONTENTHASH_H */
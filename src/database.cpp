@@ -10,7 +10,7 @@
 // The id is set to the application's internal name. However, anything could
 // have been used as long as it's unique to this application in some way.
 const QString Database::dbID = "niwpodcastdownloader";
-const int Database::dbVersion = 1;
+const int Database::dbVersion = 7;
 
 Database::Database()
 {
@@ -102,8 +102,8 @@ bool Database::isDownloaded(PodcastEpisode *episode)
     // Get the number of times the episode url appears in the database.
     // An episode shouldn't appear in the database more than once but it could
     // happen. More than one entry is not an issue.
-    if (execQuery(QString("SELECT count(*) FROM episodes WHERE url='%1';")
-        .arg(episode->getUrl().toString())))
+    if (execQuery("SELECT count(*) FROM episodes WHERE url=?;",
+        QList<QVariant>() << episode->getUrl().toString()))
     {
         if (!m_query->next()) {
             // Something is wrong with the db. The query was successful but we
@@ -125,11 +125,89 @@ bool Database::isDownloaded(PodcastEpisode *episode)
 
 void Database::setDownloaded(PodcastEpisode *episode)
 {
+    QString url = episode->getUrl().toString();
+
+    // Episodes marked as downloaded without being downloaded have no size.
+    QVariant size(QVariant::LongLong);
+    if (episode->getFileSize() >= 0) {
+        size = episode->getFileSize();
+    }
+
+    // Episodes marked as downloaded without being downloaded have no file.
+    // The path is stored as an empty string rather than NULL.
+    QString path("");
+    if (episode->getFileSize() >= 0) {
+        path = episode->getSaveLocation();
+    }
+
+    if (isDownloaded(episode)) {
+        if (episode->getFileSize() < 0) {
+            return;
+        }
+        execQuery("DELETE FROM episodes WHERE url=?;",
+            QList<QVariant>() << url);
+    }
+
+    // A linked episode has the same content as the file it is linked to.
+    if (!episode->getLinkedFrom().isEmpty()) {
+        execQuery("INSERT INTO episodes"
+            " (url, hash, hashtype, size, path, etag)"
+            " SELECT ?, hash, hashtype, size, ?, etag FROM episodes"
+            " WHERE path=? LIMIT 1;",
+            QList<QVariant>() << url << path << episode->getLinkedFrom());
+        if (isDownloaded(episode)) {
+            return;
+        }
+    }
+
     // Make an entry in the database for the episode url.
-    if (!isDownloaded(episode)) {
-        execQuery(QString("INSERT INTO episodes (url) VALUES('%1');")
-            .arg(episode->getUrl().toString()));
+    execQuery("INSERT INTO episodes"
+        " (url, hash, hashtype, size, path, etag)"
+        " VALUES(?, ?, ?, ?, ?, ?);",
+        QList<QVariant>() << url << episode->getContentHash()
+        << episode->getHashAlgorithm() << size << path
+        << episode->getContentETag());
+}
+
+QStringList Database::findDuplicates(PodcastEpisode *episode)
+{
+    QStringList paths;
+
+    if (episode->getContentHash().isEmpty()) {
+        return paths;
+    }
+
+    if (execQuery("SELECT path FROM episodes WHERE hashtype=? AND hash=?"
+        " AND size=? AND path!=?;",
+        QList<QVariant>() << episode->getHashAlgorithm()
+        << episode->getContentHash() << episode->getFileSize()
+        << episode->getSaveLocation()))
+    {
+        while (m_query->next()) {
+            paths.append(m_query->value(0).toString());
+        }
     }
+
+    return paths;
+}
+
+QStringList Database::findByETag(qint64 size, const QString &eTag)
+{
+    QStringList paths;
+
+    if (eTag.isEmpty()) {
+        return paths;
+    }
+
+    if (execQuery("SELECT path FROM episodes WHERE size=? AND etag=?"
+        " AND path!='';", QList<QVariant>() << size << eTag))
+    {
+        while (m_query->next()) {
+            paths.append(m_query->value(0).toString());
+        }
+    }
+
+    return paths;
 }
 
 QString Database::getLastModified(Podcast *podcast)
@@ -146,26 +224,166 @@ QString Database::getLastModified(Podcast *podcast)
     }
 }
 
+QString Database::getETag(Podcast *podcast)
+{
+    execQuery(QString(
+        "SELECT etag FROM rss WHERE url='%1';")
+        .arg(podcast->getUrl().toString()));
+
+    if (m_query->next()) {
+        return m_query->value(0).toString();
+    }
+    else {
+        return QString();
+    }
+}
+
+QString Database::getFeedHash(Podcast *podcast)
+{
+    execQuery(QString(
+        "SELECT feedhash FROM rss WHERE url='%1';")
+        .arg(podcast->getUrl().toString()));
+
+    if (m_query->next()) {
+        return m_query->value(0).toString();
+    }
+    else {
+        return QString();
+    }
+}
+
 void Database::setLastModified(Podcast *podcast)
 {
+    // A feed that was stopped early has no hash. The stored hash is still
+    // for a feed whose episodes have all been handled so it is kept.
+    QVariant feedHash(QVariant::String);
+    if (!podcast->getFeedHash().isEmpty()) {
+        feedHash = podcast->getFeedHash();
+    }
+
     // Check if there is already an entry for the podcast.
     execQuery(QString("SELECT ROWID from rss where url='%1';")
         .arg(podcast->getUrl().toString()));
 
+    // The date and ETag come from the server so they are bound rather than
+    // put in the query.
     if (m_query->next()) {
         // Update the modified time.
-        execQuery(QString(
-            "UPDATE rss SET lastmodified='%1' WHERE ROWID='%2';")
-            .arg(podcast->getLastModified())
-            .arg(m_query->value(0).toString()));
+        execQuery("UPDATE rss SET lastmodified=?, etag=?,"
+            " feedhash=COALESCE(?, feedhash) WHERE ROWID=?;",
+            QList<QVariant>() << podcast->getLastModified()
+            << podcast->getETag() << feedHash << m_query->value(0));
     }
     else {
         // Create a new entry for the podcast.
-        execQuery(QString(
-            "INSERT INTO rss (url, lastmodified) VALUES('%1', '%2');")
-            .arg(podcast->getUrl().toString())
-            .arg(podcast->getLastModified()));
+        execQuery("INSERT INTO rss (url, lastmodified, etag, feedhash)"
+            " VALUES(?, ?, ?, ?);",
+            QList<QVariant>() << podcast->getUrl().toString()
+            << podcast->getLastModified() << podcast->getETag()
+            << feedHash);
+    }
+}
+
+void Database::clearFeedHash(const QUrl &url)
+{
+    execQuery("UPDATE rss SET feedhash=NULL WHERE url=?;",
+        QList<QVariant>() << url.toString());
+}
+
+QUrl Database::getMovedUrl(Podcast *podcast)
+{
+    execQuery(QString(
+        "SELECT movedurl FROM rss WHERE url='%1';")
+        .arg(podcast->getUrl().toString()));
+
+    if (m_query->next()) {
+        return QUrl(m_query->value(0).toString());
+    }
+    else {
+        return QUrl();
+    }
+}
+
+void Database::setMovedUrl(Podcast *podcast, const QUrl &url)
+{
+    // Check if there is already an entry for the podcast.
+    execQuery(QString("SELECT ROWID from rss where url='%1';")
+        .arg(podcast->getUrl().toString()));
+
+    // The url comes from the server's Location header.
+    if (m_query->next()) {
+        execQuery("UPDATE rss SET movedurl=? WHERE ROWID=?;",
+            QList<QVariant>() << url.toString() << m_query->value(0));
+    }
+    else {
+        // The modified date will be set once the feed has been handled.
+        execQuery("INSERT INTO rss (url, lastmodified, etag, movedurl)"
+            " VALUES(?, '', '', ?);",
+            QList<QVariant>() << podcast->getUrl().toString()
+            << url.toString());
+    }
+}
+
+QString Database::getPartialValidator(PodcastEpisode *episode)
+{
+    execQuery(QString("SELECT validator FROM partial WHERE url='%1';")
+        .arg(episode->getUrl().toString()));
+
+    if (m_query->next()) {
+        return m_query->value(0).toString();
+    }
+    else {
+        return QString();
+    }
+}
+
+void Database::setPartial(PodcastEpisode *episode)
+{
+    // Only one partial download can exist for an episode.
+    removePartial(episode);
+
+    // The validator is an ETag or date sent by the server.
+    execQuery("INSERT INTO partial (url, rss, validator) VALUES(?, ?, ?);",
+        QList<QVariant>() << episode->getUrl().toString()
+        << episode->getPodcastUrl().toString() << episode->getValidator());
+}
+
+void Database::removePartial(PodcastEpisode *episode)
+{
+    removePartial(episode->getUrl().toString());
+}
+
+void Database::removePartial(const QString &url)
+{
+    execQuery("DELETE FROM partial WHERE url=?;", QList<QVariant>() << url);
+}
+
+QStringList Database::getPartialUrls(Podcast *podcast)
+{
+    QStringList urls;
+
+    if (execQuery("SELECT url FROM partial WHERE rss=?;",
+        QList<QVariant>() << podcast->getUrl().toString()))
+    {
+        while (m_query->next()) {
+            urls.append(m_query->value(0).toString());
+        }
+    }
+
+    return urls;
+}
+
+bool Database::hasPartial(Podcast *podcast)
+{
+    if (execQuery(QString("SELECT count(*) FROM partial WHERE rss='%1';")
+        .arg(podcast->getUrl().toString())))
+    {
+        if (m_query->next() && m_query->value(0).toInt() > 0) {
+            return true;
+        }
     }
+
+    return false;
 }
 
 bool Database::createDefaultDb()
@@ -174,8 +392,13 @@ bool Database::createDefaultDb()
 
     createQuery
         << "CREATE TABLE info (key TEXT, value TEXT);"
-        << "CREATE TABLE episodes (url TEXT);"
-        << "CREATE TABLE rss (url TEXT, lastmodified TEXT);"
+        << "CREATE TABLE episodes (url TEXT, hash TEXT, hashtype TEXT,"
+            " size INTEGER, path TEXT, etag TEXT);"
+        << "CREATE INDEX episodes_hash ON episodes (hash);"
+        << "CREATE INDEX episodes_size ON episodes (size, etag);"
+        << "CREATE TABLE rss (url TEXT, lastmodified TEXT, etag TEXT,"
+            " movedurl TEXT, feedhash TEXT);"
+        << "CREATE TABLE partial (url TEXT, rss TEXT, validator TEXT);"
         << QString("INSERT INTO info (key, value) VALUES('id', '%1');")
             .arg(dbID)
         << QString("INSERT INTO info (key, value) VALUES('version', '%2');")
@@ -244,7 +467,78 @@ bool Database::verifyDb()
 
 bool Database::updateDb(int version)
 {
-    Q_UNUSED(version);
+    QStringList updateQuery;
+
+    // Version 2 tracks partially downloaded episodes so they can be resumed.
+    if (version < 2) {
+        updateQuery
+            << "CREATE TABLE partial (url TEXT, rss TEXT, validator TEXT);";
+    }
+    // Version 3 stores the ETag of rss feeds.
+    if (version < 3) {
+        updateQuery << "ALTER TABLE rss ADD COLUMN etag TEXT;";
+    }
+    // Version 4 stores where rss feeds have permanently moved to.
+    if (version < 4) {
+        updateQuery << "ALTER TABLE rss ADD COLUMN movedurl TEXT;";
+    }
+    // Version 5 stores the content hash and size of downloaded episodes.
+    if (version < 5) {
+        updateQuery
+            << "ALTER TABLE episodes ADD COLUMN hash TEXT;"
+            << "ALTER TABLE episodes ADD COLUMN hashtype TEXT;"
+            << "ALTER TABLE episodes ADD COLUMN size INTEGER;";
+    }
+    // Version 6 indexes downloaded episodes by content so identical
+    // episodes can be linked instead of stored twice.
+    if (version < 6) {
+        updateQuery
+            << "ALTER TABLE episodes ADD COLUMN path TEXT;"
+            << "ALTER TABLE episodes ADD COLUMN etag TEXT;"
+            << "CREATE INDEX episodes_hash ON episodes (hash);"
+            << "CREATE INDEX episodes_size ON episodes (size, etag);";
+    }
+    // Version 7 stores the hash of rss feeds so a feed that is sent again
+    // unchanged can be treated as not modified.
+    if (version < 7) {
+        updateQuery << "ALTER TABLE rss ADD COLUMN feedhash TEXT;";
+    }
+
+    updateQuery
+        << QString("UPDATE info SET value='%1' WHERE key='version';")
+            .arg(dbVersion);
+
+    Q_FOREACH(QString query, updateQuery) {
+        if (!m_query->exec(query)) {
+            m_openError = tr("Could not update database because %1.")
+                .arg(m_query->lastError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Database::execQuery(const QString &query,
+    const QList<QVariant> &values)
+{
+    // We can't use a db that hasn't been opened.
+    if (!m_db.isOpen()) {
+        emit error(tr("Database not open."), true);
+        return false;
+    }
+
+    m_query->prepare(query);
+    Q_FOREACH (QVariant value, values) {
+        m_query->addBindValue(value);
+    }
+
+    if (!m_query->exec()) {
+        emit error(tr("Database Query (%1) failed because %2.").arg(query)
+            .arg(m_query->lastError().text()), false);
+        return false;
+    }
+
     return true;
 }
 
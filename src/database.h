@@ -24,6 +24,9 @@
 #include <QObject>
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QStringList>
+#include <QUrl>
+#include <QVariant>
 
 #include "podcast.h"
 #include "podcastepisode.h"
@@ -73,9 +76,34 @@ class Database : public QObject
         /**
          * Sets the episode as having been downloaded in the episode db.
          *
+         * The content hash and size of the episode are stored with it.
+         *
          * @param episode The episode to set as downloaded.
          */
         void setDownloaded(PodcastEpisode *episode);
+        /**
+         * Finds downloaded episodes with the same content as an episode.
+         *
+         * Episodes match when their content hash, hash algorithm and size
+         * are the same.
+         *
+         * @param episode The downloaded episode.
+         *
+         * @return The file names including path of the matching episodes.
+         * The files may no longer exist.
+         */
+        QStringList findDuplicates(PodcastEpisode *episode);
+        /**
+         * Finds downloaded episodes that the server reported the same size
+         * and strong ETag for.
+         *
+         * @param size The size in bytes.
+         * @param eTag The ETag.
+         *
+         * @return The file names including path of the matching episodes.
+         * The files may no longer exist.
+         */
+        QStringList findByETag(qint64 size, const QString &eTag);
 
         /**
          * Gets the last modified date of the rss feed.
@@ -86,11 +114,109 @@ class Database : public QObject
          */
         QString getLastModified(Podcast *podcast);
         /**
-         * Sets the last modified date of the rss feed.
+         * Gets the ETag of the rss feed.
+         *
+         * @param podcast The podcast to get the ETag for.
+         *
+         * @return The ETag. An empty string if the server did not send one.
+         */
+        QString getETag(Podcast *podcast);
+        /**
+         * Gets the hash of the rss feed from the last time it was
+         * downloaded.
+         *
+         * @param podcast The podcast to get the hash for.
+         *
+         * @return The hash. An empty string if the feed has not been read
+         * to the end.
+         */
+        QString getFeedHash(Podcast *podcast);
+        /**
+         * Sets the last modified date, ETag and hash of the rss feed.
+         *
+         * The stored hash is kept if the feed was not read to the end.
          *
          * @param podcast The podcast to set the modified date for.
          */
         void setLastModified(Podcast *podcast);
+        /**
+         * Forgets the hash of the rss feed.
+         *
+         * The feed will be parsed next time even if it has not changed.
+         *
+         * @param url The url of the podcast.
+         */
+        void clearFeedHash(const QUrl &url);
+        /**
+         * Gets the url the rss feed has permanently moved to.
+         *
+         * @param podcast The podcast to get the moved url for.
+         *
+         * @return The url to download the feed from. An empty url if the feed
+         * has not moved.
+         */
+        QUrl getMovedUrl(Podcast *podcast);
+        /**
+         * Sets the url the rss feed has permanently moved to.
+         *
+         * The url in the podcast listings file is still used to identify the
+         * podcast.
+         *
+         * @param podcast The podcast that moved.
+         * @param url The url the feed moved to. An empty url to forget the
+         * move.
+         */
+        void setMovedUrl(Podcast *podcast, const QUrl &url);
+
+        /**
+         * Gets the validator recorded for a partially downloaded episode.
+         *
+         * @param episode The episode to get the validator for.
+         *
+         * @return The ETag or Last-Modified date the server reported when
+         * the partial download started. An empty string if there is no
+         * partial download for the episode.
+         */
+        QString getPartialValidator(PodcastEpisode *episode);
+        /**
+         * Records that the episode has been partially downloaded.
+         *
+         * The validator of the episode is stored so the download can be
+         * resumed safely.
+         *
+         * @param episode The episode being downloaded.
+         */
+        void setPartial(PodcastEpisode *episode);
+        /**
+         * Removes the partial download record for the episode.
+         *
+         * @param episode The episode that no longer has a partial download.
+         */
+        void removePartial(PodcastEpisode *episode);
+        /**
+         * Removes the partial download record for an episode url.
+         *
+         * @param url The url of the episode.
+         */
+        void removePartial(const QString &url);
+        /**
+         * Gets the episodes of a podcast that are partially downloaded.
+         *
+         * @param podcast The podcast.
+         *
+         * @return The urls of the episodes.
+         */
+        QStringList getPartialUrls(Podcast *podcast);
+        /**
+         * Check if the podcast has any episodes that are partially
+         * downloaded.
+         *
+         * @param podcast The podcast to check.
+         *
+         * @return True if there is at least one partial download for the
+         * podcast.
+         */
+        bool hasPartial(Podcast *podcast);
 
     signals:
         /**
@@ -131,6 +257,18 @@ class Database : public QObject
          * @return True if the query was successfully executed.
          */
         bool execQuery(const QString &query);
+        /**
+         * Executes a SQLite query with values bound to its ? placeholders.
+         *
+         * Used for values from feeds and servers so they can't change the
+         * query.
+         *
+         * @param query The query to execute.
+         * @param values The values in the order of the placeholders.
+         *
+         * @return True if the query was successfully executed.
+         */
+        bool execQuery(const QString &query, const QList<QVariant> &values);
 
         /**
          * The database connection.
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "dateparser.h"
+
+qint64 DateParser::parseRfc822(const QString &date)
+{
+    qint64 seconds = parse(date.unicode(), date.size());
+    if (seconds < 0) {
+        return -1;
+    }
+    return seconds;
+}
+
+qint64 DateParser::parseRfc822(const QByteArray &date)
+{
+    return parseRfc822(QString::fromLatin1(date.constData(), date.size()));
+}
+
+qint64 DateParser::parse(const QChar *date, int size)
+{
+    int pos = 0;
+    int digits = 0;
+
+    // The weekday is optional and not checked.
+    skipSpace(date, size, &pos, 0);
+    if (pos < size && date[pos].isLetter()) {
+        skipWord(date, size, &pos);
+        skipSpace(date, size, &pos, ',');
+    }
+
+    int day = readNumber(date, size, &pos, 2, &digits);
+    skipSpace(date, size, &pos, '-');
+
+    int start = pos;
+    int month = monthFromName(date + start, skipWord(date, size, &pos));
+    skipSpace(date, size, &pos, '-');
+
+    int year = readNumber(date, size, &pos, 4, &digits);
+    if (day < 1 || month < 1 || year < 0) {
+        return -1;
+    }
+    if (digits == 2) {
+        year += year < 50 ? 2000 : 1900;
+    }
+    else if (digits == 3) {
+        year += 1900;
+    }
+    if (day > daysInMonth(year, month)) {
+        return -1;
+    }
+
+    skipSpace(date, size, &pos, 0);
+    int hour = readNumber(date, size, &pos, 2, &digits);
+    if (hour < 0 || hour > 23 || pos >= size
+        || date[pos] != QLatin1Char(':'))
+    {
+        return -1;
+    }
+    pos++;
+
+    int minute = readNumber(date, size, &pos, 2, &digits);
+    if (minute < 0 || minute > 59) {
+        return -1;
+    }
+
+    int second = 0;
+    if (pos < size && date[pos] == QLatin1Char(':')) {
+        pos++;
+        second = readNumber(date, size, &pos, 2, &digits);
+        if (second < 0 || second > 60) {
+            return -1;
+        }
+        // A leap second is counted as the second before it.
+        second = qMin(second, 59);
+    }
+
+    // Minutes east of UTC.
+    int offset = 0;
+    skipSpace(date, size, &pos, 0);
+    if (pos < size && (date[pos] == QLatin1Char('+')
+        || date[pos] == QLatin1Char('-')))
+    {
+        int sign = date[pos] == QLatin1Char('-') ? -1 : 1;
+        pos++;
+
+        int hours = readNumber(date, size, &pos, 2, &digits);
+        if (pos < size && date[pos] == QLatin1Char(':')) {
+            pos++;
+        }
+        int minutes = readNumber(date, size, &pos, 2, &digits);
+        if (minutes < 0) {
+            minutes = 0;
+        }
+        if (hours < 0 || hours > 23 || minutes > 59) {
+            return -1;
+        }
+        offset = sign * (hours * 60 + minutes);
+    }
+    else if (pos < size && date[pos].isLetter()) {
+        start = pos;
+        offset = zoneOffset(date + start, skipWord(date, size, &pos));
+    }
+
+    return daysFromEpoch(year, month, day) * 86400 + hour * 3600
+        + minute * 60 + second - offset * 60;
+}
+
+int DateParser::readNumber(const QChar *date, int size, int *pos,
+    int maxDigits, int *digits)
+{
+    int number = 0;
+
+    *digits = 0;
+    while (*pos < size && *digits < maxDigits && date[*pos].isDigit()) {
+        number = number * 10 + date[*pos].digitValue();
+        (*pos)++;
+        (*digits)++;
+    }
+
+    if (*digits == 0) {
+        return -1;
+    }
+    return number;
+}
+
+void DateParser::skipSpace(const QChar *date, int size, int *pos,
+    char separator)
+{
+    while (*pos < size && (date[*pos].isSpace()
+        || (separator != 0 && date[*pos] == QLatin1Char(separator))))
+    {
+        (*pos)++;
+    }
+}
+
+int DateParser::skipWord(const QChar *date, int size, int *pos)
+{
+    int start = *pos;
+
+    while (*pos < size && date[*pos].isLetter()) {
+        (*pos)++;
+    }
+
+    return *pos - start;
+}
+
+bool DateParser::isWord(const QChar *word, int size, const char *name)
+{
+    for (int i = 0; i < size; i++) {
+        if (name[i] == 0 || word[i].toLower() != QLatin1Char(name[i])) {
+            return false;
+        }
+    }
+    return name[size] == 0;
+}
+
+int DateParser::monthFromName(const QChar *word, int size)
+{
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+
+    // Only the first three letters are looked at so full names work too.
+    if (size < 3) {
+        return -1;
+    }
+
+    for (int month = 0; month < 12; month++) {
+        if (word[0].toLower() == QLatin1Char(months[month * 3])
+            && word[1].toLower() == QLatin1Char(months[month * 3 + 1])
+            && word[2].toLower() == QLatin1Char(months[month * 3 + 2]))
+        {
+            return month + 1;
+        }
+    }
+
+    return -1;
+}
+
+int DateParser::zoneOffset(const QChar *word, int size)
+{
+    // The zones named in RFC 822. Military zones and any others are
+    // treated as UTC as RFC 2822 recommends.
+    static const char *const names[] = {"ut", "utc", "gmt", "z", "est",
+        "edt", "cst", "cdt", "mst", "mdt", "pst", "pdt"};
+    static const int offsets[] = {0, 0, 0, 0, -300, -240, -360, -300, -420,
+        -360, -480, -420};
+
+    for (int i = 0; i < 12; i++) {
+        if (isWord(word, size, names[i])) {
+            return offsets[i];
+        }
+    }
+
+    return 0;
+}
+
+qint64 DateParser::daysFromEpoch(int year, int month, int day)
+{
+    // Count from March so the leap day is at the end of the year.
+    if (month <= 2) {
+        year--;
+    }
+
+    qint64 era = year / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5
+        + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100
+        + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+int DateParser::daysInMonth(int year, int month)
+{
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30,
+        31};
+
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0)
+        || year % 400 == 0))
+    {
+        return 29;
+    }
+    return days[month - 1];
+}
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef DATEPARSER_H
+#define DATEPARSER_H
+
+#include <QByteArray>
+#include <QChar>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * Parses the dates used by rss feeds and HTTP headers.
+ */
+class DateParser
+{
+    public:
+        /**
+         * Parses an RFC 822 or RFC 2822 date such as
+         * "Tue, 10 Jun 2008 04:00:00 -0500".
+         *
+         * The weekday is optional and not checked. Two digit years are
+         * read as 1950 to 2049. The time zone can be a numeric offset or a
+         * named zone such as GMT or EST. A missing or unknown zone is
+         * treated as UTC. Full month names and - between the day, month and
+         * year are accepted as well.
+         *
+         * No strings are created while parsing.
+         *
+         * @param date The date.
+         *
+         * @return The time in seconds since 1970-01-01 00:00:00 UTC. -1 if
+         * the date could not be parsed or is before 1970.
+         */
+        static qint64 parseRfc822(const QString &date);
+        /**
+         * Parses an RFC 822 or RFC 2822 date from a header.
+         *
+         * @param date The date.
+         *
+         * @return The time in seconds since 1970-01-01 00:00:00 UTC. -1 if
+         * the date could not be parsed or is before 1970.
+         *
+         * @see parseRfc822(const QString &)
+         */
+        static qint64 parseRfc822(const QByteArray &date);
+
+    private:
+        /**
+         * Parses an RFC 822 or RFC 2822 date.
+         *
+         * @param date The characters of the date.
+         * @param size The number of characters.
+         *
+         * @return The time in seconds since 1970-01-01 00:00:00 UTC.
+         * Negative if the date could not be parsed or is before 1970.
+         */
+        static qint64 parse(const QChar *date, int size);
+        /**
+         * Read a number.
+         *
+         * @param date The characters of the date.
+         * @param size The number of characters.
+         * @param pos The position to read from. Moved past the number.
+         * @param maxDigits The most digits to read.
+         * @param digits Set to the number of digits read.
+         *
+         * @return The number. -1 if there is no number at pos.
+         */
+        static int readNumber(const QChar *date, int size, int *pos,
+            int maxDigits, int *digits);
+        /**
+         * Skip spaces, tabs and the given separator.
+         *
+         * @param date The characters of the date.
+         * @param size The number of characters.
+         * @param pos The position to skip from. Moved past what was skipped.
+         * @param separator Another character to skip. 0 for none.
+         */
+        static void skipSpace(const QChar *date, int size, int *pos,
+            char separator);
+        /**
+         * Skip a word.
+         *
+         * @param date The characters of the date.
+         * @param size The number of characters.
+         * @param pos The start of the word. Moved past the word.
+         *
+         * @return The number of letters in the word.
+         */
+        static int skipWord(const QChar *date, int size, int *pos);
+        /**
+         * Compare a word to a name without regard to case.
+         *
+         * @param word The characters of the word.
+         * @param size The number of characters in the word.
+         * @param name The lower case name.
+         *
+         * @return True if the word is the name.
+         */
+        static bool isWord(const QChar *word, int size, const char *name);
+        /**
+         * Gets the month a name starts with.
+         *
+         * @param word The characters of the name.
+         * @param size The number of characters.
+         *
+         * @return The month from 1 to 12. -1 if it is not a month.
+         */
+        static int monthFromName(const QChar *word, int size);
+        /**
+         * Gets the offset of a named time zone.
+         *
+         * @param word The characters of the name.
+         * @param size The number of characters.
+         *
+         * @return The offset from UTC in minutes. 0 for unknown zones.
+         */
+        static int zoneOffset(const QChar *word, int size);
+        /**
+         * Gets the number of days from 1970-01-01 to a date.
+         *
+         * @param year The year.
+         * @param month The month from 1 to 12.
+         * @param day The day of the month.
+         *
+         * @return The number of days.
+         */
+        static qint64 daysFromEpoch(int year, int month, int day);
+        /**
+         * Gets the number of days in a month.
+         *
+         * @param year The year.
+         * @param month The month from 1 to 12.
+         *
+         * @return The number of days.
+         */
+        static int daysInMonth(int year, int month);
+};
+
+#endif /* DATEPARSER_H */
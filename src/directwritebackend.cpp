@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "directwritebackend.h"
+
+#ifdef HAVE_DIRECT_WRITE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QFile>
+
+const qint64 DirectWriteBackend::alignment = 4096;
+const qint64 DirectWriteBackend::alignedBufferSize = 1048576;
+
+DirectWriteBackend::DirectWriteBackend()
+{
+    void *buffer = 0;
+
+    if (posix_memalign(&buffer, alignment, alignedBufferSize) != 0) {
+        buffer = 0;
+    }
+    m_alignedBuffer = static_cast<char *>(buffer);
+}
+
+DirectWriteBackend::~DirectWriteBackend()
+{
+    Q_FOREACH (int handle, m_files.keys()) {
+        close(handle);
+    }
+    free(m_alignedBuffer);
+}
+
+QString DirectWriteBackend::getName() const
+{
+    return "direct";
+}
+
+bool DirectWriteBackend::open(int handle, const QString &path)
+{
+    QByteArray name = QFile::encodeName(path);
+    Descriptors descriptors;
+
+    descriptors.buffered = ::open(name.constData(), O_WRONLY | O_CREAT, 0666);
+    if (descriptors.buffered == -1) {
+        return false;
+    }
+
+    descriptors.direct = -1;
+    if (m_alignedBuffer) {
+        descriptors.direct = ::open(name.constData(), O_WRONLY | O_DIRECT);
+    }
+
+    m_files.insert(handle, descriptors);
+    return true;
+}
+
+bool DirectWriteBackend::write(int handle, qint64 position,
+    const char *data, qint64 size)
+{
+    if (!m_files.contains(handle)) {
+        return false;
+    }
+    Descriptors &descriptors = m_files[handle];
+
+    if (descriptors.direct == -1) {
+        return writeAll(descriptors.buffered, position, data, size);
+    }
+
+    // Split the write into an unaligned head, an aligned middle and an
+    // unaligned tail.
+    qint64 alignedStart = ((position + alignment - 1) / alignment)
+        * alignment;
+    qint64 alignedEnd = ((position + size) / alignment) * alignment;
+
+    if (alignedEnd <= alignedStart) {
+        return writeAll(descriptors.buffered, position, data, size);
+    }
+
+    if (!writeAll(descriptors.buffered, position, data,
+        alignedStart - position))
+    {
+        return false;
+    }
+
+    qint64 offset = alignedStart;
+    while (offset < alignedEnd) {
+        qint64 length = qMin(alignedBufferSize, alignedEnd - offset);
+        memcpy(m_alignedBuffer, data + (offset - position), length);
+
+        ssize_t written = pwrite(descriptors.direct, m_alignedBuffer, length,
+            offset);
+        if (written != length) {
+            if (written == -1 && errno == EINTR) {
+                continue;
+            }
+            // Direct writes are not possible on this file. Write the rest
+            // through the buffered descriptor.
+            ::close(descriptors.direct);
+            descriptors.direct = -1;
+            return writeAll(descriptors.buffered, offset,
+                data + (offset - position), position + size - offset);
+        }
+        offset += length;
+    }
+
+    return writeAll(descriptors.buffered, alignedEnd,
+        data + (alignedEnd - position), position + size - alignedEnd);
+}
+
+bool DirectWriteBackend::close(int handle)
+{
+    if (!m_files.contains(handle)) {
+        return false;
+    }
+    Descriptors descriptors = m_files.take(handle);
+
+    if (descriptors.direct != -1) {
+        ::close(descriptors.direct);
+    }
+    return ::close(descriptors.buffered) == 0;
+}
+
+bool DirectWriteBackend::writeAll(int fd, qint64 position, const char *data,
+    qint64 size)
+{
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, position);
+
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        position += written;
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+#endif /* HAVE_DIRECT_WRITE */
@@ -0,0 +1,104 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef DIRECTWRITEBACKEND_H
+#define DIRECTWRITEBACKEND_H
+
+#include <QtGlobal>
+
+#if defined(Q_OS_LINUX) && !defined(NO_PLATFORM)
+#define HAVE_DIRECT_WRITE
+
+#include <QHash>
+
+#include "writebackend.h"
+
+/**
+ * Writes with O_DIRECT so episode data does not fill the page cache.
+ *
+ * O_DIRECT requires the file position, size and memory of each write to be
+ * aligned. The aligned middle of each write is copied to an aligned buffer
+ * and written directly. The unaligned head and tail are written through a
+ * second, buffered descriptor. If the file system does not support O_DIRECT
+ * all data is written through the buffered descriptor.
+ */
+class DirectWriteBackend : public WriteBackend
+{
+    public:
+        DirectWriteBackend();
+        ~DirectWriteBackend();
+
+        QString getName() const;
+        bool open(int handle, const QString &path);
+        bool write(int handle, qint64 position, const char *data,
+            qint64 size);
+        bool close(int handle);
+
+    private:
+        /**
+         * The descriptors for an open file.
+         */
+        struct Descriptors {
+            /**
+             * Descriptor opened without O_DIRECT.
+             */
+            int buffered;
+            /**
+             * Descriptor opened with O_DIRECT. -1 if direct writes are not
+             * possible.
+             */
+            int direct;
+        };
+
+        /**
+         * Writes all of the data to a descriptor.
+         *
+         * @param fd The descriptor.
+         * @param position Where to write the data.
+         * @param data The data.
+         * @param size The number of bytes to write.
+         *
+         * @return True if everything was written.
+         */
+        bool writeAll(int fd, qint64 position, const char *data,
+            qint64 size);
+
+        /**
+         * The alignment required by O_DIRECT.
+         */
+        static const qint64 alignment;
+        /**
+         * The size of the aligned buffer.
+         */
+        static const qint64 alignedBufferSize;
+
+        /**
+         * The open files.
+         */
+        QHash<int, Descriptors> m_files;
+        /**
+         * Aligned memory that direct writes are copied into.
+         */
+        char *m_alignedBuffer;
+};
+
+#endif /* Q_OS_LINUX && !NO_PLATFORM */
+
+#endif /* DIRECTWRITEBACKEND_H */
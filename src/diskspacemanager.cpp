@@ -0,0 +1,119 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "diskspacemanager.h"
+#include "platform.h"
+
+const int DiskSpaceManager::refreshInterval = 10000;
+
+DiskSpaceManager::DiskSpaceManager()
+{
+    m_minimumFreeSpace = 0;
+    m_freeSpace = -1;
+    m_stale = true;
+}
+
+void DiskSpaceManager::setPath(const QString &path)
+{
+    m_path = path;
+    m_stale = true;
+}
+
+void DiskSpaceManager::setMinimumFreeSpace(qlonglong size)
+{
+    m_minimumFreeSpace = size < 0 ? -1 : size * 1024;
+}
+
+qint64 DiskSpaceManager::getAvailable()
+{
+    if (m_minimumFreeSpace < 0) {
+        return -1;
+    }
+
+    refresh();
+    if (m_freeSpace < 0) {
+        return -1;
+    }
+
+    qint64 available = m_freeSpace - m_minimumFreeSpace;
+    Q_FOREACH (Reservation reservation, m_reservations) {
+        available -= qMax(reservation.size - reservation.written,
+            Q_INT64_C(0));
+    }
+
+    return available;
+}
+
+bool DiskSpaceManager::hasSpace(qint64 size)
+{
+    if (m_minimumFreeSpace < 0) {
+        return true;
+    }
+
+    qint64 available = getAvailable();
+    if (m_freeSpace < 0) {
+        return true;
+    }
+
+    return available >= size;
+}
+
+void DiskSpaceManager::reserve(PodcastEpisode *episode, qint64 size)
+{
+    if (m_reservations.contains(episode)) {
+        m_reservations[episode].size = qMax(size, Q_INT64_C(0));
+        return;
+    }
+
+    Reservation reservation;
+    reservation.size = qMax(size, Q_INT64_C(0));
+    // Data from a previous attempt is already counted in the free space.
+    reservation.written = episode->getResumeOffset();
+    m_reservations.insert(episode, reservation);
+}
+
+void DiskSpaceManager::release(PodcastEpisode *episode)
+{
+    if (m_reservations.remove(episode) > 0) {
+        // What the episode wrote since the last refresh is no longer
+        // covered by its reservation.
+        m_stale = true;
+    }
+}
+
+void DiskSpaceManager::refresh()
+{
+    if (!m_stale && m_lastRefresh.isValid()
+        && m_lastRefresh.elapsed() < refreshInterval)
+    {
+        return;
+    }
+
+    qlonglong freeSpace = Platform::getFreeDiskSpace(m_path);
+    m_freeSpace = freeSpace < 0 ? -1 : freeSpace * 1024;
+    m_lastRefresh.start();
+    m_stale = false;
+
+    // The bytes written so far are now part of the free space figure.
+    QHash<PodcastEpisode *, Reservation>::iterator i;
+    for (i = m_reservations.begin(); i != m_reservations.end(); ++i) {
+        i.value().written = i.key()->getResumeOffset();
+    }
+}
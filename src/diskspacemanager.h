@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef DISKSPACEMANAGER_H
+#define DISKSPACEMANAGER_H
+
+#include <QHash>
+#include <QString>
+#include <QTime>
+
+#include "podcastepisode.h"
+
+/**
+ * Keeps track of the disk space episode downloads will use.
+ *
+ * Each running episode download reserves the size it is expected to be.
+ * The free space reported by the file system is cached and only read again
+ * periodically or after a download has released its reservation. A new
+ * download is only started if its expected size fits in the free space that
+ * is not already reserved.
+ */
+class DiskSpaceManager
+{
+    public:
+        DiskSpaceManager();
+
+        /**
+         * Sets the directory the episodes are saved in.
+         *
+         * @param path The save location.
+         */
+        void setPath(const QString &path);
+        /**
+         * Sets the amount of space that must be left free.
+         *
+         * @param size The size in KB. Less than 0 disables the checks.
+         */
+        void setMinimumFreeSpace(qlonglong size);
+
+        /**
+         * Gets the space that is free and not reserved.
+         *
+         * @return The available space in bytes. Can be negative if the
+         * reservations are larger than the free space. -1 if the checks are
+         * disabled or the free space cannot be determined.
+         */
+        qint64 getAvailable();
+        /**
+         * Is there enough space for a download.
+         *
+         * @param size The number of bytes the download needs.
+         *
+         * @return True if the size fits in the available space or the
+         * available space cannot be determined.
+         */
+        bool hasSpace(qint64 size);
+        /**
+         * Reserve space for an episode.
+         *
+         * Calling this again for the same episode changes the size of the
+         * reservation.
+         *
+         * @param episode The episode being downloaded.
+         * @param size The size the episode is expected to be in bytes. 0 if
+         * it is not known.
+         */
+        void reserve(PodcastEpisode *episode, qint64 size);
+        /**
+         * Removes the reservation for an episode.
+         *
+         * @param episode The episode that has stopped downloading.
+         */
+        void release(PodcastEpisode *episode);
+
+    private:
+        /**
+         * An episode's reservation.
+         */
+        struct Reservation
+        {
+            /**
+             * The expected size of the episode.
+             */
+            qint64 size;
+            /**
+             * The bytes already on disk when the free space was last read.
+             * These are part of the cached free space.
+             */
+            qint64 written;
+        };
+
+        /**
+         * Read the free space from the file system if the cached value is
+         * old.
+         */
+        void refresh();
+
+        /**
+         * The directory the episodes are saved in.
+         */
+        QString m_path;
+        /**
+         * The space that must be left free in bytes.
+         */
+        qint64 m_minimumFreeSpace;
+        /**
+         * The free space when it was last read in bytes. -1 if unknown.
+         */
+        qint64 m_freeSpace;
+        /**
+         * When the free space was last read.
+         */
+        QTime m_lastRefresh;
+        /**
+         * The cached free space must be read again before it is used.
+         */
+        bool m_stale;
+        /**
+         * The space reserved for each running episode download.
+         */
+        QHash<PodcastEpisode *, Reservation> m_reservations;
+
+        /**
+         * The longest time the free space is cached in milliseconds.
+         */
+        static const int refreshInterval;
+};
+
+#endif /* DISKSPACEMANAGER_H */
@@ -0,0 +1,346 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <QMutexLocker>
+
+#include "diskwriter.h"
+#include "platform.h"
+
+DiskWriter::DiskWriter(WriteBackend *backend)
+{
+    m_backend = backend;
+    m_backendName = backend->getName();
+    m_nextHandle = 0;
+    m_notify = false;
+    m_stopped = false;
+    m_writeCount = 0;
+    m_timedCount = 0;
+    m_totalLatency = 0;
+    m_maximumLatency = -1;
+    m_maximumQueueDepth = 0;
+}
+
+DiskWriter::~DiskWriter()
+{
+    stop();
+    wait();
+
+    // Anything left was queued after the thread stopped.
+    Q_FOREACH (Operation operation, m_queue) {
+        releaseData(operation);
+    }
+
+    delete m_backend;
+}
+
+int DiskWriter::open(const QString &path)
+{
+    Operation operation;
+
+    m_mutex.lock();
+    operation.handle = m_nextHandle++;
+    m_mutex.unlock();
+
+    operation.type = Operation::Open;
+    operation.path = path;
+    operation.position = 0;
+    operation.data = 0;
+    operation.size = 0;
+    operation.pool = 0;
+    enqueue(operation);
+
+    return operation.handle;
+}
+
+void DiskWriter::write(int handle, qint64 position, char *data, qint64 size,
+    BufferPool *pool)
+{
+    Operation operation;
+
+    operation.type = Operation::Write;
+    operation.handle = handle;
+    operation.position = position;
+    operation.data = data;
+    operation.size = size;
+    operation.pool = pool;
+    enqueue(operation);
+}
+
+void DiskWriter::close(int handle)
+{
+    Operation operation;
+
+    operation.type = Operation::Close;
+    operation.handle = handle;
+    operation.position = 0;
+    operation.data = 0;
+    operation.size = 0;
+    operation.pool = 0;
+    enqueue(operation);
+}
+
+void DiskWriter::waitForWrites(int handle)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_pending.value(handle) > 0) {
+        m_done.wait(&m_mutex);
+    }
+}
+
+bool DiskWriter::hasFailed(int handle)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failed.contains(handle);
+}
+
+void DiskWriter::notifyWhenWritten()
+{
+    QMutexLocker locker(&m_mutex);
+    m_notify = true;
+}
+
+void DiskWriter::stop()
+{
+    Operation operation;
+
+    operation.type = Operation::Stop;
+    operation.handle = -1;
+    operation.position = 0;
+    operation.data = 0;
+    operation.size = 0;
+    operation.pool = 0;
+    enqueue(operation);
+}
+
+QString DiskWriter::getBackendName() const
+{
+    return m_backendName;
+}
+
+qint64 DiskWriter::getWriteCount()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_writeCount;
+}
+
+qint64 DiskWriter::getAverageLatency()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_timedCount == 0) {
+        return -1;
+    }
+    return m_totalLatency / m_timedCount;
+}
+
+qint64 DiskWriter::getMaximumLatency()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumLatency;
+}
+
+int DiskWriter::getMaximumQueueDepth()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumQueueDepth;
+}
+
+void DiskWriter::run()
+{
+    int batchSize = qMax(m_backend->getBatchSize(), 1);
+
+    Q_FOREVER {
+        m_mutex.lock();
+        while (m_queue.isEmpty()) {
+            m_queued.wait(&m_mutex);
+        }
+        // Writes that are waiting together are given to the backend as one
+        // batch.
+        QList<Operation> operations;
+        operations.append(m_queue.takeFirst());
+        while (operations.first().type == Operation::Write
+            && operations.size() < batchSize && !m_queue.isEmpty()
+            && m_queue.first().type == Operation::Write)
+        {
+            operations.append(m_queue.takeFirst());
+        }
+        QList<bool> skip;
+        Q_FOREACH (Operation operation, operations) {
+            skip.append(m_failed.contains(operation.handle));
+        }
+        m_mutex.unlock();
+
+        if (operations.first().type == Operation::Stop) {
+            break;
+        }
+
+        // Once a file has failed the rest of its data is thrown away.
+        QList<bool> results;
+        qint64 latency = -1;
+        qint64 start = Platform::getTimeMicroseconds();
+        if (operations.first().type == Operation::Write) {
+            results = performWrites(operations, skip);
+            if (start >= 0) {
+                latency = Platform::getTimeMicroseconds() - start;
+            }
+        }
+        else if (!skip.first()
+            || operations.first().type == Operation::Close)
+        {
+            results.append(perform(operations.first()));
+        }
+        else {
+            results.append(true);
+        }
+        Q_FOREACH (Operation operation, operations) {
+            releaseData(operation);
+        }
+
+        m_mutex.lock();
+        bool notify = false;
+        for (int i = 0; i < operations.size(); i++) {
+            const Operation &operation = operations.at(i);
+
+            if (operation.type == Operation::Close) {
+                m_failed.remove(operation.handle);
+            }
+            else if (!results.at(i)) {
+                m_failed.insert(operation.handle);
+            }
+
+            if (m_pending.value(operation.handle) <= 1) {
+                m_pending.remove(operation.handle);
+            }
+            else {
+                m_pending[operation.handle]--;
+            }
+
+            if (operation.type == Operation::Write) {
+                m_writeCount++;
+                // Every write in a batch finished when the batch did.
+                if (latency >= 0 && !skip.at(i)) {
+                    m_timedCount++;
+                    m_totalLatency += latency;
+                    m_maximumLatency = qMax(m_maximumLatency, latency);
+                }
+                notify = notify || m_notify;
+                m_notify = false;
+            }
+        }
+        m_done.wakeAll();
+        m_mutex.unlock();
+
+        if (notify) {
+            emit writesCompleted();
+        }
+    }
+}
+
+void DiskWriter::enqueue(const Operation &operation)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Writes queued after the thread stopped would never be done.
+    if (m_stopped) {
+        if (operation.type != Operation::Stop) {
+            m_failed.insert(operation.handle);
+        }
+        releaseData(operation);
+        return;
+    }
+
+    m_queue.append(operation);
+    if (operation.type == Operation::Stop) {
+        m_stopped = true;
+    }
+    else {
+        m_pending[operation.handle]++;
+    }
+    m_maximumQueueDepth = qMax(m_maximumQueueDepth, m_queue.size());
+    m_queued.wakeOne();
+}
+
+bool DiskWriter::perform(const Operation &operation)
+{
+    switch (operation.type) {
+        case Operation::Open:
+            return m_backend->open(operation.handle, operation.path);
+        case Operation::Write:
+            return m_backend->write(operation.handle, operation.position,
+                operation.data, operation.size);
+        case Operation::Close:
+            return m_backend->close(operation.handle);
+        default:
+            return true;
+    }
+}
+
+QList<bool> DiskWriter::performWrites(const QList<Operation> &operations,
+    const QList<bool> &skip)
+{
+    QList<WriteBackend::Request> requests;
+
+    for (int i = 0; i < operations.size(); i++) {
+        if (skip.at(i)) {
+            continue;
+        }
+
+        WriteBackend::Request request;
+        request.handle = operations.at(i).handle;
+        request.position = operations.at(i).position;
+        request.data = operations.at(i).data;
+        request.size = operations.at(i).size;
+        request.ok = false;
+        requests.append(request);
+    }
+
+    if (!requests.isEmpty()) {
+        m_backend->writeBatch(requests);
+    }
+
+    // Skipped writes are not failures of their own.
+    QList<bool> results;
+    int next = 0;
+    for (int i = 0; i < operations.size(); i++) {
+        if (skip.at(i)) {
+            results.append(true);
+        }
+        else {
+            results.append(requests.at(next++).ok);
+        }
+    }
+
+    return results;
+}
+
+void DiskWriter::releaseData(const Operation &operation)
+{
+    if (!operation.data) {
+        return;
+    }
+
+    if (operation.pool) {
+        operation.pool->release(operation.data);
+    }
+    else {
+        delete[] operation.data;
+    }
+}
@@ -0,0 +1,267 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef DISKWRITER_H
+#define DISKWRITER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "bufferpool.h"
+#include "writebackend.h"
+
+/**
+ * Writes episode data to disk in a thread of its own.
+ *
+ * Writes are queued from the main thread and done in order by a
+ * WriteBackend so slow disks do not hold up reading from the network. Writes
+ * that are waiting together are handed to the backend as one batch. The
+ * queue is bounded by the buffers handed to it. A buffer from a BufferPool
+ * is returned to the pool once it has been written.
+ */
+class DiskWriter : public QThread
+{
+    Q_OBJECT
+
+    public:
+        /**
+         * @param backend The backend that does the writing. The writer
+         * takes ownership of it.
+         */
+        DiskWriter(WriteBackend *backend);
+        /**
+         * Waits for the queued writes to finish before returning.
+         */
+        ~DiskWriter();
+
+        /**
+         * Opens a file for writing. The file is not truncated.
+         *
+         * @param path The file name including path.
+         *
+         * @return The handle to write to the file with.
+         */
+        int open(const QString &path);
+        /**
+         * Queues data to be written.
+         *
+         * @param handle The file.
+         * @param position Where to write the data.
+         * @param data The data. The writer takes ownership of it.
+         * @param size The number of bytes to write.
+         * @param pool The pool the data was taken from. 0 if the data was
+         * allocated with new[].
+         */
+        void write(int handle, qint64 position, char *data, qint64 size,
+            BufferPool *pool);
+        /**
+         * Closes a file once everything queued for it has been written.
+         *
+         * @param handle The file.
+         */
+        void close(int handle);
+        /**
+         * Blocks until everything queued for a file has been written.
+         *
+         * @param handle The file.
+         */
+        void waitForWrites(int handle);
+        /**
+         * Has opening or writing to a file failed.
+         *
+         * @param handle The file.
+         *
+         * @return True if data queued for the file was not written.
+         */
+        bool hasFailed(int handle);
+        /**
+         * Request that writesCompleted be emitted after the next write
+         * finishes.
+         */
+        void notifyWhenWritten();
+        /**
+         * Finish the queued writes and stop the thread.
+         */
+        void stop();
+
+        /**
+         * Gets the name of the backend.
+         *
+         * @return The backend name.
+         */
+        QString getBackendName() const;
+        /**
+         * Gets the number of writes done.
+         *
+         * @return The number of writes.
+         */
+        qint64 getWriteCount();
+        /**
+         * Gets the average time a write took.
+         *
+         * @return The average latency in microseconds. -1 if it is not
+         * known.
+         */
+        qint64 getAverageLatency();
+        /**
+         * Gets the longest time a write took.
+         *
+         * @return The maximum latency in microseconds. -1 if it is not
+         * known.
+         */
+        qint64 getMaximumLatency();
+        /**
+         * Gets the largest number of operations that were waiting in the
+         * queue.
+         *
+         * @return The maximum queue depth.
+         */
+        int getMaximumQueueDepth();
+
+    signals:
+        /**
+         * This signal is emitted after a write when notifyWhenWritten was
+         * called. Buffers will have been returned to their pool.
+         */
+        void writesCompleted();
+
+    protected:
+        void run();
+
+    private:
+        /**
+         * An operation waiting in the queue.
+         */
+        struct Operation {
+            enum Type {Open, Write, Close, Stop};
+
+            Type type;
+            int handle;
+            QString path;
+            qint64 position;
+            char *data;
+            qint64 size;
+            BufferPool *pool;
+        };
+
+        /**
+         * Add an operation to the queue.
+         *
+         * @param operation The operation.
+         */
+        void enqueue(const Operation &operation);
+        /**
+         * Do an operation. Called from the writer thread.
+         *
+         * @param operation The operation.
+         *
+         * @return True if the operation succeeded.
+         */
+        bool perform(const Operation &operation);
+        /**
+         * Do a batch of writes. Called from the writer thread.
+         *
+         * @param operations The writes.
+         * @param skip Which writes are for files that have failed and are
+         * not done.
+         *
+         * @return Whether each write succeeded.
+         */
+        QList<bool> performWrites(const QList<Operation> &operations,
+            const QList<bool> &skip);
+        /**
+         * Give the data of a write back to whoever it belongs to.
+         *
+         * @param operation The write.
+         */
+        void releaseData(const Operation &operation);
+
+        /**
+         * Does the writing. Only used in the writer thread.
+         */
+        WriteBackend *m_backend;
+        /**
+         * The name of the backend.
+         */
+        QString m_backendName;
+        /**
+         * Operations waiting to be done.
+         */
+        QList<Operation> m_queue;
+        /**
+         * The number of operations queued or in progress for each handle.
+         */
+        QHash<int, int> m_pending;
+        /**
+         * Handles that could not be opened or written to.
+         */
+        QSet<int> m_failed;
+        /**
+         * The next handle to give out.
+         */
+        int m_nextHandle;
+        /**
+         * Whether to emit writesCompleted after the next write.
+         */
+        bool m_notify;
+        /**
+         * Whether stop has been called.
+         */
+        bool m_stopped;
+        /**
+         * The number of writes done.
+         */
+        qint64 m_writeCount;
+        /**
+         * The number of writes that were timed.
+         */
+        qint64 m_timedCount;
+        /**
+         * The time taken by all timed writes in microseconds.
+         */
+        qint64 m_totalLatency;
+        /**
+         * The longest write in microseconds.
+         */
+        qint64 m_maximumLatency;
+        /**
+         * The largest number of operations waiting.
+         */
+        int m_maximumQueueDepth;
+        /**
+         * Guards everything shared between the threads.
+         */
+        QMutex m_mutex;
+        /**
+         * Signaled when an operation is queued.
+         */
+        QWaitCondition m_queued;
+        /**
+         * Signaled when an operation is done.
+         */
+        QWaitCondition m_done;
+};
+
+#endif /* DISKWRITER_H */
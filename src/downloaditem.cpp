@@ -18,6 +18,9 @@
  *   <http://www.gnu.org/licenses/>.                                         *
  *****************************************************************************/
 
+#include <QDateTime>
+
+#include "dateparser.h"
 #include "downloaditem.h"
 
 DownloadItem::DownloadItem()
@@ -25,6 +28,21 @@ DownloadItem::DownloadItem()
     m_name = "";
     m_url.clear();
     m_reply = 0;
+    m_failureType = PermanentFailure;
+    m_failureStatus = -1;
+    m_retryAfter = -1;
+    m_temporaryRedirect = false;
+    m_connectTimeout = 0;
+    m_firstByteTimeout = 0;
+    m_idleTimeout = 0;
+    m_minimumRate = 0;
+    m_minimumRateWindow = 1;
+    m_responseStarted = false;
+    m_receivedBytes = 0;
+    m_windowBytes = 0;
+
+    m_watchdog.setInterval(1000);
+    connect(&m_watchdog, SIGNAL(timeout()), this, SLOT(checkWatchdog()));
 }
 
 QString DownloadItem::getName() const
@@ -42,6 +60,31 @@ QString DownloadItem::getLastModified() const
     return QString::fromAscii(m_lastModified);
 }
 
+QString DownloadItem::getETag() const
+{
+    return QString::fromAscii(m_eTag);
+}
+
+DownloadItem::FailureType DownloadItem::getFailureType() const
+{
+    return m_failureType;
+}
+
+int DownloadItem::getFailureStatus() const
+{
+    return m_failureStatus;
+}
+
+int DownloadItem::getRetryAfter() const
+{
+    return m_retryAfter;
+}
+
+QUrl DownloadItem::getPermanentUrl() const
+{
+    return m_permanentUrl;
+}
+
 void DownloadItem::setName(const QString &name)
 {
     m_name = name;
@@ -52,6 +95,27 @@ void DownloadItem::setUrl(const QUrl &url)
     m_url = url;
 }
 
+void DownloadItem::clearRedirects()
+{
+    m_rssMovedUrls.clear();
+    m_permanentUrl.clear();
+    m_temporaryRedirect = false;
+}
+
+void DownloadItem::setTimeouts(int connectTimeout, int firstByteTimeout,
+    int idleTimeout)
+{
+    m_connectTimeout = qMax(connectTimeout, 0);
+    m_firstByteTimeout = qMax(firstByteTimeout, 0);
+    m_idleTimeout = qMax(idleTimeout, 0);
+}
+
+void DownloadItem::setMinimumRate(qint64 rate, int window)
+{
+    m_minimumRate = qMax(rate, Q_INT64_C(0));
+    m_minimumRateWindow = qMax(window, 1);
+}
+
 void DownloadItem::setNetworkReply(QNetworkReply *reply)
 {
     // Disconnect any signals if a reply was previously set. A new reply may
@@ -63,6 +127,9 @@ void DownloadItem::setNetworkReply(QNetworkReply *reply)
     }
 
     m_reply = reply;
+    // Errors that are not network errors, such as a feed that cannot be
+    // parsed, will not be fixed by trying again.
+    setFailure(PermanentFailure);
     // If the reply is not deleted elsewhere we want the reply to be deleted
     // when this is deleted.
     m_reply->setParent(this);
@@ -75,6 +142,19 @@ void DownloadItem::setNetworkReply(QNetworkReply *reply)
     connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
     connect(m_reply, SIGNAL(sslErrors(const QList<QSslError> &)), m_reply,
         SLOT(ignoreSslErrors()));
+
+    startWatchdog();
+}
+
+void DownloadItem::abort(const QString &errorString, FailureType type)
+{
+    if (!m_reply) {
+        return;
+    }
+
+    setFailure(type);
+    cleanDownload();
+    emit error(this, errorString);
 }
 
 void DownloadItem::downloadFinished()
@@ -85,14 +165,27 @@ void DownloadItem::downloadFinished()
 
     // The error condition check prevents a seg fault.
     if (m_reply->error() != QNetworkReply::NoError) {
+        QVariant statusCode = m_reply->attribute(
+            QNetworkRequest::HttpStatusCodeAttribute);
+        QString errorPhrase = m_reply->attribute(
+            QNetworkRequest::HttpReasonPhraseAttribute).toString();
+
+        setFailure(m_reply);
         cleanDownload();
         // Do not use m_reply->errorString() to display a more complete error
         // message because it will cause a seg fault.
-        emit error(this, tr("Connection failed."));
+        if (!statusCode.isNull()) {
+            emit error(this, tr("Http status %1: %2.").arg(statusCode.toInt())
+                .arg(errorPhrase));
+        }
+        else {
+            emit error(this, tr("Connection failed."));
+        }
         return;
     }
     if (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isNull())
     {
+        setFailure(TransientFailure);
         cleanDownload();
         emit error(this, tr("Connection failed because no HTTP status code was"
             " returned."));
@@ -105,28 +198,31 @@ void DownloadItem::downloadFinished()
         // OK
         // Everything is fine, the download completed successfully.
         case 200:
-            // downloadSuccessful must be called before cleanDownload.
-            // cleanDownload must be called before the finished signal is
-            // emitted. downloadSuccessful is determined by the subclass.
-            if (downloadSuccessful()) {
-                m_lastModified = m_reply->rawHeader("Last-Modified");
-                cleanDownload();
-                emit finished(this);
-            }
-            else {
-                cleanDownload();
-            }
+            // Fall though wanted.
+        // Partial Content
+        // A resumed download completed successfully.
+        case 206:
+            completeDownload();
             break;
         // Moved Permanently
         case 301:
             // Fall though wanted.
         // Moved Temporarily
         case 302: {
-            QUrl newUrl = m_reply->attribute(
-                QNetworkRequest::RedirectionTargetAttribute).toUrl();
+            // The target can be relative to the url that was requested.
+            QUrl newUrl = m_reply->url().resolved(m_reply->attribute(
+                QNetworkRequest::RedirectionTargetAttribute).toUrl());
 
             if (!m_rssMovedUrls.contains(newUrl.toString())) {
                 m_rssMovedUrls.append(newUrl.toString());
+                if (m_reply->attribute(
+                    QNetworkRequest::HttpStatusCodeAttribute).toInt() != 301)
+                {
+                    m_temporaryRedirect = true;
+                }
+                else if (!m_temporaryRedirect) {
+                    m_permanentUrl = newUrl;
+                }
                 DownloadItem::cleanDownload();
                 emit contentMoved(this, newUrl);
             }
@@ -160,6 +256,8 @@ void DownloadItem::downloadFinished()
                     QNetworkRequest::HttpReasonPhraseAttribute).toString();
             }
 
+            setFailure(m_reply);
+            cleanDownload();
             emit error(this, tr("Http status %1: %2.")
                 .arg(errorCode)
                 .arg(errorPhrase));
@@ -167,6 +265,239 @@ void DownloadItem::downloadFinished()
     }
 }
 
+void DownloadItem::completeDownload()
+{
+    // downloadSuccessful must be called before cleanDownload.
+    // cleanDownload must be called before the finished signal is
+    // emitted. downloadSuccessful is determined by the subclass.
+    if (downloadSuccessful()) {
+        m_lastModified = m_reply->rawHeader("Last-Modified");
+        m_eTag = m_reply->rawHeader("ETag");
+        cleanDownload();
+        emit finished(this);
+    }
+    else {
+        cleanDownload();
+    }
+}
+
+void DownloadItem::setFailure(FailureType type, int retryAfter)
+{
+    m_failureType = type;
+    m_failureStatus = -1;
+    m_retryAfter = retryAfter;
+}
+
+void DownloadItem::setFailure(QNetworkReply *reply)
+{
+    QVariant statusCode = reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute);
+
+    // Retry-After is either a delay in seconds or an HTTP-date. A date is
+    // measured against the server's Date header when it sent one so clock
+    // skew between us and the server doesn't matter. If neither form can
+    // be read the normal back off is used.
+    bool ok = false;
+    int retryAfter = reply->rawHeader("Retry-After").trimmed().toInt(&ok);
+    if (!ok) {
+        qint64 retryTime = DateParser::parseRfc822(
+            reply->rawHeader("Retry-After"));
+        qint64 now = DateParser::parseRfc822(reply->rawHeader("Date"));
+        if (now < 0) {
+            now = QDateTime::currentDateTime().toUTC().toTime_t();
+        }
+
+        if (retryTime >= 0) {
+            retryAfter = qMax(retryTime - now, qint64(0));
+            ok = true;
+        }
+    }
+    if (!ok || retryAfter < 0) {
+        retryAfter = -1;
+    }
+
+    if (!statusCode.isNull()) {
+        int status = statusCode.toInt();
+
+        if (status == 429) {
+            setFailure(ThrottledFailure, retryAfter);
+        }
+        else if (status >= 500) {
+            setFailure(ServerFailure, retryAfter);
+        }
+        // Request Timeout
+        else if (status == 408) {
+            setFailure(TransientFailure, retryAfter);
+        }
+        else {
+            setFailure(PermanentFailure);
+        }
+        m_failureStatus = status;
+        return;
+    }
+
+    switch (reply->error()) {
+        // The server will not give us the content no matter how many times
+        // we ask.
+        case QNetworkReply::ContentAccessDenied:
+        case QNetworkReply::ContentOperationNotPermittedError:
+        case QNetworkReply::ContentNotFoundError:
+        case QNetworkReply::AuthenticationRequiredError:
+        case QNetworkReply::ProtocolUnknownError:
+        case QNetworkReply::ProtocolInvalidOperationError:
+            setFailure(PermanentFailure);
+            break;
+        default:
+            setFailure(TransientFailure);
+            break;
+    }
+}
+
+void DownloadItem::startWatchdog()
+{
+    m_receivedBytes = 0;
+    m_windowBytes = 0;
+    m_replyBytes.clear();
+    m_startTime.start();
+    m_activityTime.start();
+    m_windowTime.start();
+
+    // A reply can already have its headers when it replaces one that was
+    // slower to respond.
+    m_responseStarted = !m_reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).isNull();
+    if (m_responseStarted) {
+        m_responseTime.start();
+    }
+
+    watchReply(m_reply);
+
+    if (m_connectTimeout > 0 || m_firstByteTimeout > 0 || m_idleTimeout > 0
+        || m_minimumRate > 0)
+    {
+        m_watchdog.start();
+    }
+}
+
+void DownloadItem::stopWatchdog()
+{
+    m_watchdog.stop();
+}
+
+bool DownloadItem::isThrottled() const
+{
+    return false;
+}
+
+void DownloadItem::watchReply(QNetworkReply *reply)
+{
+    m_replyBytes.insert(reply, 0);
+
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(responseStarted()));
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this,
+        SLOT(replyProgress(qint64, qint64)));
+}
+
+void DownloadItem::responseStarted()
+{
+    if (sender() == m_reply && !m_responseStarted) {
+        m_responseStarted = true;
+        m_responseTime.start();
+        m_activityTime.start();
+    }
+}
+
+void DownloadItem::replyProgress(qint64 received, qint64 total)
+{
+    Q_UNUSED(total);
+
+    // Progress is reported as a total for each reply.
+    QObject *reply = sender();
+    if (!m_replyBytes.contains(reply)) {
+        return;
+    }
+
+    qint64 bytes = received - m_replyBytes.value(reply);
+    if (bytes <= 0) {
+        return;
+    }
+    m_replyBytes.insert(reply, received);
+
+    m_receivedBytes += bytes;
+    m_windowBytes += bytes;
+    m_activityTime.start();
+}
+
+void DownloadItem::checkWatchdog()
+{
+    if (!m_reply) {
+        m_watchdog.stop();
+        m_replyBytes.clear();
+        return;
+    }
+
+    if (!m_responseStarted) {
+        if (m_connectTimeout > 0
+            && m_startTime.elapsed() > m_connectTimeout * 1000)
+        {
+            timeOut(tr("No response from the server within %1 seconds.")
+                .arg(m_connectTimeout));
+        }
+        return;
+    }
+
+    // The server is not stalled while its data waits for the bandwidth
+    // limiter. Only time the reader is free to read counts.
+    if (isThrottled()) {
+        m_responseTime.start();
+        m_activityTime.start();
+        m_windowBytes = 0;
+        m_windowTime.start();
+        return;
+    }
+
+    if (m_receivedBytes == 0) {
+        if (m_firstByteTimeout > 0
+            && m_responseTime.elapsed() > m_firstByteTimeout * 1000)
+        {
+            timeOut(tr("No data from the server within %1 seconds.")
+                .arg(m_firstByteTimeout));
+        }
+        return;
+    }
+
+    if (m_idleTimeout > 0 && m_activityTime.elapsed() > m_idleTimeout * 1000)
+    {
+        timeOut(tr("No data from the server for %1 seconds.")
+            .arg(m_idleTimeout));
+        return;
+    }
+
+    if (m_minimumRate > 0
+        && m_windowTime.elapsed() >= m_minimumRateWindow * 1000)
+    {
+        qint64 rate = m_windowBytes * 1000 / m_windowTime.elapsed();
+
+        m_windowBytes = 0;
+        m_windowTime.start();
+        if (rate < m_minimumRate) {
+            timeOut(tr("Transfer rate of %1 bytes per second is below the"
+                " minimum of %2.").arg(rate).arg(m_minimumRate));
+        }
+    }
+}
+
+void DownloadItem::timeOut(const QString &reason)
+{
+    m_watchdog.stop();
+    m_replyBytes.clear();
+
+    // A later attempt may well be faster.
+    setFailure(TransientFailure);
+    cleanDownload();
+    emit error(this, reason);
+}
+
 void DownloadItem::cleanDownload()
 {
     if (m_reply) {
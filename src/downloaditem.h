@@ -21,9 +21,12 @@
 #ifndef DOWNLOADITEM_H
 #define DOWNLOADITEM_H
 
+#include <QHash>
 #include <QNetworkReply>
 #include <QObject>
 #include <QStringList>
+#include <QTime>
+#include <QTimer>
 #include <QUrl>
 
 /**
@@ -37,6 +40,31 @@ class DownloadItem : public QObject
     Q_OBJECT
 
     public:
+        /**
+         * Why a download failed.
+         *
+         * Used to decide if a failed download should be tried again.
+         */
+        enum FailureType {
+            /**
+             * A network problem that is likely to go away, such as a reset
+             * connection.
+             */
+            TransientFailure,
+            /**
+             * The server reported an error of its own (5xx).
+             */
+            ServerFailure,
+            /**
+             * The server asked for requests to slow down (429).
+             */
+            ThrottledFailure,
+            /**
+             * Trying again will not help, such as a 404 or a parse error.
+             */
+            PermanentFailure
+        };
+
         DownloadItem();
 
         /**
@@ -59,6 +87,44 @@ class DownloadItem : public QObject
          * @return A representation of when the item was last modified.
          */
         QString getLastModified() const;
+        /**
+         * Gets the entity tag the server reported for the item.
+         *
+         * @return The ETag. An empty string if the server did not send one.
+         */
+        QString getETag() const;
+        /**
+         * Gets why the last download failed.
+         *
+         * Only meaningful after the error signal has been emitted.
+         *
+         * @return The type of failure.
+         */
+        FailureType getFailureType() const;
+        /**
+         * Gets the HTTP status the last download failed with.
+         *
+         * @return The status code. -1 if the failure was not an HTTP error
+         * status.
+         */
+        int getFailureStatus() const;
+        /**
+         * Gets how long the server asked to wait before trying again.
+         *
+         * @return The number of seconds from the Retry-After header. -1 if
+         * the server did not send one.
+         */
+        int getRetryAfter() const;
+        /**
+         * Gets the url the item has permanently moved to.
+         *
+         * Only 301 redirects that were not preceded by a temporary redirect
+         * are counted.
+         *
+         * @return The target of the last permanent redirect. An empty url if
+         * there was none.
+         */
+        QUrl getPermanentUrl() const;
 
         /**
          * Sets the name of the item.
@@ -72,6 +138,35 @@ class DownloadItem : public QObject
          * @param url The url of the rss feed.
          */
         void setUrl(const QUrl &url);
+        /**
+         * Forget the redirects followed by a previous attempt.
+         *
+         * This must be called before the item is downloaded again otherwise
+         * following the same redirect will be seen as an infinite loop.
+         */
+        void clearRedirects();
+        /**
+         * Sets how long the download can wait on the server before it is
+         * stopped and reported as a transient failure.
+         *
+         * @param connectTimeout Seconds to wait for the response headers.
+         * @param firstByteTimeout Seconds to wait for the first data after
+         * the headers.
+         * @param idleTimeout Seconds without receiving data once data has
+         * started arriving.
+         *
+         * Any of the timeouts can be 0 to disable it.
+         */
+        void setTimeouts(int connectTimeout, int firstByteTimeout,
+            int idleTimeout);
+        /**
+         * Sets the slowest the download can transfer before it is stopped
+         * and reported as a transient failure.
+         *
+         * @param rate The minimum rate in bytes per second. 0 to disable.
+         * @param window The number of seconds the rate is averaged over.
+         */
+        void setMinimumRate(qint64 rate, int window);
 
         /**
          * Sets the network reply used for downloading the item.
@@ -84,6 +179,17 @@ class DownloadItem : public QObject
          * @see downloadFinished
          */
         void setNetworkReply(QNetworkReply *reply);
+        /**
+         * Stops the download.
+         *
+         * The error signal is emitted with the given reason.
+         *
+         * @param errorString Why the download was stopped.
+         * @param type Why the download failed. A permanent failure is not
+         * tried again.
+         */
+        void abort(const QString &errorString,
+            FailureType type=PermanentFailure);
 
     public slots:
         /**
@@ -139,19 +245,99 @@ class DownloadItem : public QObject
          * there was an error.
          */
         virtual bool downloadSuccessful() = 0;
+        /**
+         * Finish a download that has completed successfully.
+         *
+         * Calls downloadSuccessful and emits the finished signal if the
+         * processing succeeded. This is called by downloadFinished and can
+         * be called by derived classes that finish a download without
+         * waiting for the network reply to finish.
+         *
+         * @see downloadSuccessful
+         * @see finished
+         */
+        void completeDownload();
+        /**
+         * Sets why the download failed.
+         *
+         * This should be called before the error signal is emitted.
+         *
+         * @param type The type of failure.
+         * @param retryAfter The number of seconds the server asked to wait
+         * before trying again. -1 if it did not say.
+         */
+        void setFailure(FailureType type, int retryAfter=-1);
+        /**
+         * Sets why the download failed based on a failed network reply.
+         *
+         * @param reply The reply that failed.
+         */
+        void setFailure(QNetworkReply *reply);
         /**
          * Clean up any resources used by the download.
          *
          * This is necessary if the download is stopped before it completes.
          */
         virtual void cleanDownload();
+        /**
+         * Whether received data is waiting for the bandwidth limiter.
+         *
+         * The watchdog does not count time spent waiting as a stall.
+         *
+         * @return True if data is being held back. The default is false.
+         */
+        virtual bool isThrottled() const;
+        /**
+         * Start watching m_reply for stalls.
+         *
+         * Called when a new reply is set.
+         */
+        void startWatchdog();
+        /**
+         * Stop watching m_reply for stalls.
+         *
+         * Used when the reply has finished but the download is still being
+         * processed.
+         */
+        void stopWatchdog();
+        /**
+         * Count data received by an additional reply that is part of the
+         * download, such as a segment, as activity.
+         *
+         * @param reply The reply.
+         */
+        void watchReply(QNetworkReply *reply);
 
         /**
          * The network reply associated with the download.
          */
         QNetworkReply *m_reply;
 
+    private slots:
+        /**
+         * A watched reply received its response headers.
+         */
+        void responseStarted();
+        /**
+         * A watched reply received data.
+         *
+         * @param received The total bytes the reply has received.
+         * @param total The total bytes expected. Not used.
+         */
+        void replyProgress(qint64 received, qint64 total);
+        /**
+         * Stop the download if it has stalled or is too slow.
+         */
+        void checkWatchdog();
+
     private:
+        /**
+         * Stop the download because a watchdog expired.
+         *
+         * @param reason Why the download was stopped.
+         */
+        void timeOut(const QString &reason);
+
         /**
          * The name of the item.
          */
@@ -164,6 +350,23 @@ class DownloadItem : public QObject
          * When the item was last modified on the server.
          */
         QByteArray m_lastModified;
+        /**
+         * The entity tag the server reported for the item.
+         */
+        QByteArray m_eTag;
+        /**
+         * Why the last download failed.
+         */
+        FailureType m_failureType;
+        /**
+         * The HTTP status the last download failed with.
+         */
+        int m_failureStatus;
+        /**
+         * The number of seconds the server asked to wait before trying
+         * again.
+         */
+        int m_retryAfter;
 
         /**
          * A list of urls used with 301 and 302 content moved responses.
@@ -172,6 +375,74 @@ class DownloadItem : public QObject
          * loop.
          */
         QStringList m_rssMovedUrls;
+        /**
+         * The target of the last permanent redirect.
+         */
+        QUrl m_permanentUrl;
+        /**
+         * Whether a temporary redirect has been followed.
+         *
+         * Permanent redirects after a temporary one are not permanent for
+         * the original url.
+         */
+        bool m_temporaryRedirect;
+
+        /**
+         * Runs checkWatchdog while a download is running.
+         */
+        QTimer m_watchdog;
+        /**
+         * Seconds to wait for the response headers. 0 for no limit.
+         */
+        int m_connectTimeout;
+        /**
+         * Seconds to wait for the first data. 0 for no limit.
+         */
+        int m_firstByteTimeout;
+        /**
+         * Seconds to wait between data. 0 for no limit.
+         */
+        int m_idleTimeout;
+        /**
+         * The minimum rate in bytes per second. 0 for no limit.
+         */
+        qint64 m_minimumRate;
+        /**
+         * The number of seconds m_minimumRate is averaged over.
+         */
+        int m_minimumRateWindow;
+        /**
+         * When the current reply was set.
+         */
+        QTime m_startTime;
+        /**
+         * When the response headers arrived.
+         */
+        QTime m_responseTime;
+        /**
+         * When data was last received.
+         */
+        QTime m_activityTime;
+        /**
+         * When the current rate window started.
+         */
+        QTime m_windowTime;
+        /**
+         * Whether the response headers have arrived.
+         */
+        bool m_responseStarted;
+        /**
+         * The bytes received by all replies of the download.
+         */
+        qint64 m_receivedBytes;
+        /**
+         * The bytes received in the current rate window.
+         */
+        qint64 m_windowBytes;
+        /**
+         * The bytes received by each watched reply.
+         */
+        QHash<QObject *, qint64> m_replyBytes;
 };
 
 #endif /* DOWNLOADITEM_H */
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "elementtable.h"
+
+void ElementTable::insert(const QString &name, int id)
+{
+    m_lengths[name.size()].append(m_names.size());
+    m_names.append(name.toLower());
+    m_ids.append(id);
+}
+
+int ElementTable::find(const QString &name) const
+{
+    return find(name.unicode(), name.size());
+}
+
+int ElementTable::find(const QStringRef &name) const
+{
+    return find(name.unicode(), name.size());
+}
+
+int ElementTable::find(const QChar *name, int size) const
+{
+    QHash<int, QList<int> >::const_iterator candidates =
+        m_lengths.constFind(size);
+    if (candidates == m_lengths.constEnd()) {
+        return -1;
+    }
+
+    Q_FOREACH (int index, candidates.value()) {
+        const QChar *known = m_names.at(index).unicode();
+        int i = 0;
+
+        while (i < size && name[i].toLower() == known[i]) {
+            i++;
+        }
+        if (i == size) {
+            return m_ids.at(index);
+        }
+    }
+
+    return -1;
+}
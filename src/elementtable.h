@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef ELEMENTTABLE_H
+#define ELEMENTTABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringRef>
+
+/**
+ * Maps xml element names to ids so parsers can dispatch on an element with
+ * a switch.
+ *
+ * Names are matched without regard to case. Each name is stored once in
+ * lower case and looked up without creating any strings, so an element can
+ * be matched against every name the parser knows without the repeated
+ * trimmed().toLower() copies.
+ */
+class ElementTable
+{
+    public:
+        /**
+         * Add a name to the table.
+         *
+         * @param name The element name.
+         * @param id The id find returns for the name. Must not be -1.
+         */
+        void insert(const QString &name, int id);
+        /**
+         * Look up an element name.
+         *
+         * @param name The element name.
+         *
+         * @return The id of the name. -1 if the name is not in the table.
+         */
+        int find(const QString &name) const;
+        /**
+         * Look up an element name.
+         *
+         * @param name The element name.
+         *
+         * @return The id of the name. -1 if the name is not in the table.
+         */
+        int find(const QStringRef &name) const;
+
+    private:
+        /**
+         * Look up an element name.
+         *
+         * @param name The characters of the name.
+         * @param size The number of characters.
+         *
+         * @return The id of the name. -1 if the name is not in the table.
+         */
+        int find(const QChar *name, int size) const;
+
+        /**
+         * The names in lower case.
+         */
+        QList<QString> m_names;
+        /**
+         * The id of each name in m_names.
+         */
+        QList<int> m_ids;
+        /**
+         * The positions in m_names of the names of each length. Only names
+         * of the same length need to be compared.
+         */
+        QHash<int, QList<int> > m_lengths;
+};
+
+#endif /* ELEMENTTABLE_H */
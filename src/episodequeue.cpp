@@ -0,0 +1,185 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <QtAlgorithms>
+
+#include "episodequeue.h"
+
+EpisodeQueue::EpisodeQueue()
+{
+    m_policy = RoundRobinPolicy;
+    m_sequence = 0;
+    m_round = -1;
+}
+
+EpisodeQueue::~EpisodeQueue()
+{
+    clear();
+}
+
+EpisodeQueue::Policy EpisodeQueue::policyFromName(const QString &name,
+    bool *ok)
+{
+    QString policy = name.trimmed().toLower();
+
+    if (ok) {
+        *ok = true;
+    }
+
+    if (policy == "newest") {
+        return NewestFirstPolicy;
+    }
+    else if (policy == "shortest") {
+        return ShortestFirstPolicy;
+    }
+    else if (policy != "round_robin" && ok) {
+        *ok = false;
+    }
+
+    return RoundRobinPolicy;
+}
+
+void EpisodeQueue::setPolicy(Policy policy)
+{
+    m_policy = policy;
+}
+
+void EpisodeQueue::enqueue(Podcast *podcast)
+{
+    int position = 0;
+
+    while (PodcastEpisode *episode = podcast->takeFirstEpisode()) {
+        Entry entry;
+        entry.episode = episode;
+        entry.podcast = podcast;
+        entry.key = getKey(episode, position);
+        entry.sequence = m_sequence++;
+
+        // Entries are added in sequence order so the new entry goes after
+        // every entry with the same key.
+        QList<Entry>::iterator i = qUpperBound(m_entries.begin(),
+            m_entries.end(), entry, lessThan);
+        m_entries.insert(i, entry);
+
+        m_pendingCount[podcast]++;
+        position++;
+    }
+}
+
+int EpisodeQueue::size() const
+{
+    return m_entries.size();
+}
+
+bool EpisodeQueue::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+PodcastEpisode *EpisodeQueue::episodeAt(int index) const
+{
+    return m_entries.at(index).episode;
+}
+
+Podcast *EpisodeQueue::podcastAt(int index) const
+{
+    return m_entries.at(index).podcast;
+}
+
+PodcastEpisode *EpisodeQueue::take(int index)
+{
+    Entry entry = m_entries.takeAt(index);
+
+    if (m_policy == RoundRobinPolicy) {
+        m_round = qMax(m_round, entry.key);
+    }
+
+    m_pendingCount[entry.podcast]--;
+    if (m_pendingCount.value(entry.podcast) <= 0) {
+        m_pendingCount.remove(entry.podcast);
+    }
+
+    return entry.episode;
+}
+
+int EpisodeQueue::getPendingCount(Podcast *podcast) const
+{
+    return m_pendingCount.value(podcast);
+}
+
+void EpisodeQueue::removePodcast(Podcast *podcast)
+{
+    QList<Entry>::iterator i = m_entries.begin();
+    while (i != m_entries.end()) {
+        if ((*i).podcast == podcast) {
+            delete (*i).episode;
+            i = m_entries.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+    m_pendingCount.remove(podcast);
+}
+
+QList<Podcast *> EpisodeQueue::clear()
+{
+    QList<Podcast *> podcasts = m_pendingCount.keys();
+
+    Q_FOREACH (Entry entry, m_entries) {
+        delete entry.episode;
+    }
+    m_entries.clear();
+    m_pendingCount.clear();
+
+    return podcasts;
+}
+
+bool EpisodeQueue::lessThan(const Entry &e1, const Entry &e2)
+{
+    if (e1.key != e2.key) {
+        return e1.key < e2.key;
+    }
+    return e1.sequence < e2.sequence;
+}
+
+qint64 EpisodeQueue::getKey(PodcastEpisode *episode, int position) const
+{
+    switch (m_policy) {
+        case NewestFirstPolicy:
+            // Negated so newer episodes sort first. Episodes without a valid
+            // date sort after every dated episode.
+            if (episode->getPublishTime() >= 0) {
+                return -episode->getPublishTime();
+            }
+            return 0;
+        case ShortestFirstPolicy:
+            if (episode->getEnclosureLength() > 0) {
+                return episode->getEnclosureLength();
+            }
+            return Q_INT64_C(0x7FFFFFFFFFFFFFFF);
+        case RoundRobinPolicy:
+        default:
+            // The podcast's first episode is downloaded in the round after
+            // the one in progress, its second in the round after that and so
+            // on.
+            return m_round + 1 + position;
+    }
+}
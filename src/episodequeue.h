@@ -0,0 +1,201 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef EPISODEQUEUE_H
+#define EPISODEQUEUE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "podcast.h"
+#include "podcastepisode.h"
+
+/**
+ * The episodes waiting to be downloaded from every podcast.
+ *
+ * The episodes are kept sorted by the ordering policy. The first episode is
+ * the next one that should be downloaded. Episodes further back can be taken
+ * when the host of an earlier one is busy.
+ */
+class EpisodeQueue
+{
+    public:
+        /**
+         * The order episodes are downloaded in.
+         */
+        enum Policy {
+            /**
+             * One episode from each podcast in turn.
+             */
+            RoundRobinPolicy,
+            /**
+             * The most recently published episodes from any podcast first.
+             */
+            NewestFirstPolicy,
+            /**
+             * The smallest episodes first using the enclosure length listed
+             * in the rss feed. Episodes without a length are last.
+             */
+            ShortestFirstPolicy
+        };
+
+        EpisodeQueue();
+        ~EpisodeQueue();
+
+        /**
+         * Gets the policy for a name.
+         *
+         * @param name One of round_robin, newest or shortest.
+         * @param ok Set to false if the name is not known.
+         *
+         * @return The policy. RoundRobinPolicy if the name is not known.
+         */
+        static Policy policyFromName(const QString &name, bool *ok=0);
+
+        /**
+         * Sets the order episodes are downloaded in.
+         *
+         * This must be set before any podcasts are added.
+         *
+         * @param policy The ordering policy.
+         */
+        void setPolicy(Policy policy);
+        /**
+         * Takes the episodes from a podcast and adds them to the queue.
+         *
+         * @param podcast The podcast. It must stay valid until all of its
+         * episodes have been taken.
+         */
+        void enqueue(Podcast *podcast);
+        /**
+         * Gets the number of episodes in the queue.
+         *
+         * @return The number of episodes.
+         */
+        int size() const;
+        /**
+         * Is the queue empty.
+         *
+         * @return True if there are no episodes in the queue.
+         */
+        bool isEmpty() const;
+        /**
+         * Gets an episode without taking it from the queue.
+         *
+         * @param index The position in the queue. 0 is the next episode.
+         *
+         * @return The episode.
+         */
+        PodcastEpisode *episodeAt(int index) const;
+        /**
+         * Gets the podcast of an episode in the queue.
+         *
+         * @param index The position in the queue.
+         *
+         * @return The podcast the episode belongs to.
+         */
+        Podcast *podcastAt(int index) const;
+        /**
+         * Takes an episode from the queue.
+         *
+         * @param index The position in the queue.
+         *
+         * @return The episode. The caller takes ownership.
+         */
+        PodcastEpisode *take(int index);
+        /**
+         * Gets the number of episodes of a podcast still in the queue.
+         *
+         * @param podcast The podcast.
+         *
+         * @return The number of episodes.
+         */
+        int getPendingCount(Podcast *podcast) const;
+        /**
+         * Deletes every episode of a podcast that is still in the queue.
+         *
+         * @param podcast The podcast.
+         */
+        void removePodcast(Podcast *podcast);
+        /**
+         * Deletes every episode in the queue.
+         *
+         * @return The podcasts that had episodes in the queue.
+         */
+        QList<Podcast *> clear();
+
+    private:
+        /**
+         * An episode in the queue.
+         */
+        struct Entry
+        {
+            PodcastEpisode *episode;
+            Podcast *podcast;
+            /**
+             * The value the policy sorts on.
+             */
+            qint64 key;
+            /**
+             * The order the episode was added in. Keeps episodes with the
+             * same key in the order they were added.
+             */
+            qint64 sequence;
+        };
+
+        /**
+         * Sort order for entries.
+         */
+        static bool lessThan(const Entry &e1, const Entry &e2);
+        /**
+         * Gets the value an episode is sorted on.
+         *
+         * @param episode The episode.
+         * @param position The position of the episode in its podcast's
+         * episode list.
+         */
+        qint64 getKey(PodcastEpisode *episode, int position) const;
+
+        /**
+         * The order episodes are downloaded in.
+         */
+        Policy m_policy;
+        /**
+         * The episodes sorted by lessThan.
+         */
+        QList<Entry> m_entries;
+        /**
+         * The number of episodes of each podcast in the queue.
+         */
+        QHash<Podcast *, int> m_pendingCount;
+        /**
+         * The number of episodes that have been added.
+         */
+        qint64 m_sequence;
+        /**
+         * The round of the last episode taken in round robin order. Podcasts
+         * added later join the next round instead of jumping ahead of
+         * podcasts already waiting. -1 before any episode has been taken.
+         */
+        qint64 m_round;
+};
+
+#endif /* EPISODEQUEUE_H */
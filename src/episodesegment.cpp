@@ -0,0 +1,71 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "episodesegment.h"
+
+EpisodeSegment::EpisodeSegment(QNetworkReply *reply, qint64 start,
+    qint64 end)
+{
+    m_reply = reply;
+    m_start = start;
+    m_end = end;
+    m_position = start;
+    m_accepted = false;
+}
+
+QNetworkReply *EpisodeSegment::getNetworkReply() const
+{
+    return m_reply;
+}
+
+qint64 EpisodeSegment::getStart() const
+{
+    return m_start;
+}
+
+qint64 EpisodeSegment::getEnd() const
+{
+    return m_end;
+}
+
+qint64 EpisodeSegment::getPosition() const
+{
+    return m_position;
+}
+
+bool EpisodeSegment::isAccepted() const
+{
+    return m_accepted;
+}
+
+bool EpisodeSegment::isComplete() const
+{
+    return m_position > m_end;
+}
+
+void EpisodeSegment::setPosition(qint64 position)
+{
+    m_position = position;
+}
+
+void EpisodeSegment::setAccepted(bool accepted)
+{
+    m_accepted = accepted;
+}
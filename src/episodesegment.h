@@ -0,0 +1,115 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef EPISODESEGMENT_H
+#define EPISODESEGMENT_H
+
+#include <QNetworkReply>
+
+/**
+ * A byte range of a podcast episode downloaded over its own connection.
+ *
+ * Used by PodcastEpisode when an episode is split into segments that are
+ * downloaded in parallel.
+ */
+class EpisodeSegment
+{
+    public:
+        /**
+         * @param reply The network reply downloading the range.
+         * @param start The first byte of the range.
+         * @param end The last byte of the range.
+         */
+        EpisodeSegment(QNetworkReply *reply, qint64 start, qint64 end);
+
+        /**
+         * Gets the network reply downloading the range.
+         *
+         * @return The network reply.
+         */
+        QNetworkReply *getNetworkReply() const;
+        /**
+         * Gets the first byte of the range.
+         *
+         * @return The start of the range.
+         */
+        qint64 getStart() const;
+        /**
+         * Gets the last byte of the range.
+         *
+         * @return The end of the range.
+         */
+        qint64 getEnd() const;
+        /**
+         * Gets the position of the next byte to write.
+         *
+         * @return The write position.
+         */
+        qint64 getPosition() const;
+        /**
+         * Has the server confirmed it is sending the requested range.
+         *
+         * @return True if the response has been checked.
+         */
+        bool isAccepted() const;
+        /**
+         * Has the whole range been written.
+         *
+         * @return True if the segment is complete.
+         */
+        bool isComplete() const;
+
+        /**
+         * Sets the position of the next byte to write.
+         *
+         * @param position The write position.
+         */
+        void setPosition(qint64 position);
+        /**
+         * Marks the response as checked.
+         *
+         * @param accepted True if the server is sending the requested range.
+         */
+        void setAccepted(bool accepted);
+
+    private:
+        /**
+         * The network reply downloading the range.
+         */
+        QNetworkReply *m_reply;
+        /**
+         * The first byte of the range.
+         */
+        qint64 m_start;
+        /**
+         * The last byte of the range.
+         */
+        qint64 m_end;
+        /**
+         * The next byte to write.
+         */
+        qint64 m_position;
+        /**
+         * Whether the response has been checked.
+         */
+        bool m_accepted;
+};
+
+#endif /* EPISODESEGMENT_H */
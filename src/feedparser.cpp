@@ -0,0 +1,257 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "dateparser.h"
+#include "feedparser.h"
+
+FeedItem::FeedItem()
+{
+    publishTime = -1;
+    length = -1;
+    isExplicit = false;
+}
+
+FeedParser::FeedParser()
+{
+    m_elements.insert("rss", RssElement);
+    m_elements.insert("channel", ChannelElement);
+    m_elements.insert("item", ItemElement);
+    m_elements.insert("title", TitleElement);
+    m_elements.insert("pubdate", PublishDateElement);
+    m_elements.insert("guid", GuidElement);
+    m_elements.insert("enclosure", EnclosureElement);
+    m_elements.insert("itunes:explicit", ExplicitElement);
+
+    reset();
+}
+
+void FeedParser::reset()
+{
+    m_reader.clear();
+    // Feeds often use prefixes such as itunes: without declaring them.
+    m_reader.setNamespaceProcessing(false);
+
+    m_error = NoError;
+    m_depth = 0;
+    m_channelFound = false;
+    m_inChannel = false;
+    m_inItem = false;
+    m_item = FeedItem();
+    m_field = NoField;
+    m_text.clear();
+    m_items.clear();
+}
+
+bool FeedParser::addData(const QByteArray &data)
+{
+    if (m_error != NoError) {
+        return false;
+    }
+
+    m_reader.addData(data);
+    return parse();
+}
+
+bool FeedParser::finish()
+{
+    if (m_error != NoError || !parse()) {
+        return false;
+    }
+
+    // Running out of data is only an error once there is no more to come.
+    if (m_reader.hasError()) {
+        m_error = XmlError;
+        return false;
+    }
+    if (!m_channelFound) {
+        m_error = NoChannelError;
+        return false;
+    }
+
+    return true;
+}
+
+QList<FeedItem> FeedParser::takeItems()
+{
+    QList<FeedItem> items = m_items;
+    m_items.clear();
+    return items;
+}
+
+FeedParser::Error FeedParser::getError() const
+{
+    return m_error;
+}
+
+QString FeedParser::errorString() const
+{
+    return m_reader.errorString();
+}
+
+qint64 FeedParser::getErrorLine() const
+{
+    return m_reader.lineNumber();
+}
+
+qint64 FeedParser::getErrorColumn() const
+{
+    return m_reader.columnNumber();
+}
+
+bool FeedParser::parse()
+{
+    while (!m_reader.atEnd()) {
+        switch (m_reader.readNext()) {
+            case QXmlStreamReader::StartElement:
+                if (!startElement()) {
+                    return false;
+                }
+                break;
+            case QXmlStreamReader::EndElement:
+                endElement();
+                break;
+            case QXmlStreamReader::Characters:
+                if (m_field != NoField) {
+                    m_text += m_reader.text();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // The reader stops with PrematureEndOfDocumentError when it needs more
+    // data.
+    if (m_reader.hasError()
+        && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError)
+    {
+        m_error = XmlError;
+        return false;
+    }
+
+    return true;
+}
+
+bool FeedParser::startElement()
+{
+    int element = m_elements.find(m_reader.qualifiedName());
+    int depth = m_depth;
+    m_depth++;
+
+    if (depth == 0) {
+        if (element != RssElement) {
+            m_error = NoRssError;
+            return false;
+        }
+    }
+    // Only the first channel is read.
+    else if (depth == 1) {
+        if (element == ChannelElement && !m_channelFound) {
+            m_channelFound = true;
+            m_inChannel = true;
+        }
+    }
+    else if (depth == 2) {
+        if (m_inChannel && element == ItemElement) {
+            m_inItem = true;
+            m_item = FeedItem();
+        }
+    }
+    else if (depth == 3 && m_inItem) {
+        m_text.clear();
+
+        switch (element) {
+            case TitleElement:
+                m_field = TitleField;
+                break;
+            case PublishDateElement:
+                m_field = PublishDateField;
+                break;
+            case GuidElement:
+                m_field = GuidField;
+                break;
+            case ExplicitElement:
+                m_field = ExplicitField;
+                break;
+            case EnclosureElement: {
+                QXmlStreamAttributes attributes = m_reader.attributes();
+                m_item.url = attributes.value(QLatin1String("url"))
+                    .toString();
+
+                // Many feeds list 0 or leave the length out when they do
+                // not know it.
+                bool ok = false;
+                qint64 length = attributes.value(QLatin1String("length"))
+                    .toString().trimmed().toLongLong(&ok);
+                if (ok && length > 0) {
+                    m_item.length = length;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+void FeedParser::endElement()
+{
+    m_depth--;
+
+    if (m_depth == 3 && m_field != NoField) {
+        endField();
+    }
+    else if (m_depth == 2 && m_inItem) {
+        m_inItem = false;
+        m_items.append(m_item);
+    }
+    else if (m_depth == 1 && m_inChannel) {
+        m_inChannel = false;
+    }
+}
+
+void FeedParser::endField()
+{
+    switch (m_field) {
+        case TitleField:
+            m_item.title = m_text;
+            break;
+        case PublishDateField:
+            // The time zone is kept so episodes from feeds in different
+            // zones are ordered correctly.
+            m_item.publishTime = DateParser::parseRfc822(m_text);
+            break;
+        case GuidField:
+            m_item.guid = m_text.trimmed();
+            break;
+        case ExplicitField:
+            // We want to be conservative. If it's not no it's assumed to be
+            // yes.
+            m_item.isExplicit = m_text.trimmed().toLower() != "no";
+            break;
+        default:
+            break;
+    }
+
+    m_field = NoField;
+    m_text.clear();
+}
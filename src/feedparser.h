@@ -0,0 +1,247 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef FEEDPARSER_H
+#define FEEDPARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QXmlStreamReader>
+
+#include "elementtable.h"
+
+/**
+ * An item read from an rss feed.
+ *
+ * Only the parts of the item that are needed to download the episode are
+ * kept.
+ */
+struct FeedItem
+{
+    FeedItem();
+
+    /**
+     * The title of the item.
+     */
+    QString title;
+    /**
+     * When the item was published in seconds since 1970-01-01 00:00:00
+     * UTC. -1 if the feed did not list a date that could be parsed.
+     */
+    qint64 publishTime;
+    /**
+     * The url attribute of the enclosure.
+     */
+    QString url;
+    /**
+     * The length attribute of the enclosure in bytes. -1 if the feed did
+     * not list it.
+     */
+    qint64 length;
+    /**
+     * The unique identifier of the item.
+     */
+    QString guid;
+    /**
+     * Whether the item is marked as explicit.
+     */
+    bool isExplicit;
+};
+
+/**
+ * Parses an rss feed as it is downloaded.
+ *
+ * Data can be given to the parser in pieces as it arrives. Each piece is
+ * parsed as far as possible and items are available as soon as they are
+ * complete. The feed is never held in memory as a whole.
+ */
+class FeedParser
+{
+    public:
+        /**
+         * Why parsing failed.
+         */
+        enum Error {
+            NoError,
+            /**
+             * The feed is not well formed xml.
+             */
+            XmlError,
+            /**
+             * The root element is not <rss>.
+             */
+            NoRssError,
+            /**
+             * There is no <channel> element in <rss>.
+             */
+            NoChannelError
+        };
+
+        FeedParser();
+
+        /**
+         * Start parsing a new feed.
+         *
+         * Any items that have not been taken are discarded.
+         */
+        void reset();
+        /**
+         * Parse the next piece of the feed.
+         *
+         * @param data The feed data.
+         *
+         * @return True on success. False if the feed could not be parsed.
+         */
+        bool addData(const QByteArray &data);
+        /**
+         * Parse the end of the feed.
+         *
+         * Call once all of the feed has been given to addData.
+         *
+         * @return True if the feed was complete and valid.
+         */
+        bool finish();
+        /**
+         * Gets the items parsed since the last call and removes them from
+         * the parser.
+         *
+         * @return The items in the order they are listed in the feed.
+         */
+        QList<FeedItem> takeItems();
+
+        /**
+         * Gets why parsing failed.
+         *
+         * @return The error. NoError if parsing has not failed.
+         */
+        Error getError() const;
+        /**
+         * The description of an XmlError.
+         *
+         * @return A human readable description of the error.
+         */
+        QString errorString() const;
+        /**
+         * The line the XmlError was found on.
+         *
+         * @return The line number.
+         */
+        qint64 getErrorLine() const;
+        /**
+         * The column the XmlError was found at.
+         *
+         * @return The column number.
+         */
+        qint64 getErrorColumn() const;
+
+    private:
+        /**
+         * The elements the parser looks for.
+         */
+        enum Element {
+            RssElement,
+            ChannelElement,
+            ItemElement,
+            TitleElement,
+            PublishDateElement,
+            GuidElement,
+            EnclosureElement,
+            ExplicitElement
+        };
+        /**
+         * The parts of an item that are read.
+         */
+        enum Field {
+            NoField,
+            TitleField,
+            PublishDateField,
+            GuidField,
+            ExplicitField
+        };
+
+        /**
+         * Read tokens until the data given so far runs out.
+         *
+         * @return True on success. False if parsing failed.
+         */
+        bool parse();
+        /**
+         * Handle the start of an element.
+         *
+         * @return True on success. False if parsing failed.
+         */
+        bool startElement();
+        /**
+         * Handle the end of an element.
+         */
+        void endElement();
+        /**
+         * Store the text read for the current field in the current item.
+         */
+        void endField();
+
+        /**
+         * Reads the feed.
+         */
+        QXmlStreamReader m_reader;
+        /**
+         * The ids of the elements the parser looks for.
+         */
+        ElementTable m_elements;
+        /**
+         * Why parsing failed.
+         */
+        Error m_error;
+        /**
+         * The number of elements the reader is inside of.
+         */
+        int m_depth;
+        /**
+         * Whether the first <channel> has been found.
+         */
+        bool m_channelFound;
+        /**
+         * Whether the reader is inside the first <channel>.
+         */
+        bool m_inChannel;
+        /**
+         * Whether the reader is inside an <item> of the channel.
+         */
+        bool m_inItem;
+        /**
+         * The item being read.
+         */
+        FeedItem m_item;
+        /**
+         * The field of the item being read.
+         */
+        Field m_field;
+        /**
+         * The text read for the current field.
+         */
+        QString m_text;
+        /**
+         * Items that have been read and not taken.
+         */
+        QList<FeedItem> m_items;
+};
+
+#endif /* FEEDPARSER_H */
@@ -0,0 +1,190 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "iouringwritebackend.h"
+
+#ifdef HAVE_IO_URING_WRITE
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QFile>
+
+const unsigned IoUringWriteBackend::queueDepth = 32;
+const qint64 IoUringWriteBackend::maxSubmission = 65536;
+
+IoUringWriteBackend::IoUringWriteBackend()
+{
+    m_ready = io_uring_queue_init(queueDepth, &m_ring, 0) == 0;
+}
+
+IoUringWriteBackend::~IoUringWriteBackend()
+{
+    Q_FOREACH (int handle, m_files.keys()) {
+        close(handle);
+    }
+    if (m_ready) {
+        io_uring_queue_exit(&m_ring);
+    }
+}
+
+bool IoUringWriteBackend::isReady() const
+{
+    return m_ready;
+}
+
+QString IoUringWriteBackend::getName() const
+{
+    return "io_uring";
+}
+
+bool IoUringWriteBackend::open(int handle, const QString &path)
+{
+    if (!m_ready) {
+        return false;
+    }
+
+    int fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT,
+        0666);
+    if (fd == -1) {
+        return false;
+    }
+
+    m_files.insert(handle, fd);
+    return true;
+}
+
+bool IoUringWriteBackend::write(int handle, qint64 position,
+    const char *data, qint64 size)
+{
+    QList<Request> requests;
+    Request request;
+
+    request.handle = handle;
+    request.position = position;
+    request.data = data;
+    request.size = size;
+    request.ok = false;
+    requests.append(request);
+
+    writeBatch(requests);
+    return requests.first().ok;
+}
+
+void IoUringWriteBackend::writeBatch(QList<Request> &requests)
+{
+    QList<qint64> written;
+    unsigned count = 0;
+
+    for (int i = 0; i < requests.size(); i++) {
+        requests[i].ok = m_files.contains(requests.at(i).handle);
+        written.append(0);
+    }
+
+    for (int i = 0; i < requests.size() && m_ready; i++) {
+        const Request &request = requests.at(i);
+        if (!request.ok) {
+            continue;
+        }
+        int fd = m_files.value(request.handle);
+
+        qint64 queued = 0;
+        while (queued < request.size) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+            // The queue is full. Submit what is in it and keep going.
+            if (!sqe) {
+                if (!submit(requests, written, count)) {
+                    break;
+                }
+                count = 0;
+                continue;
+            }
+
+            qint64 length = qMin(maxSubmission, request.size - queued);
+            io_uring_prep_write(sqe, fd, request.data + queued, length,
+                request.position + queued);
+            // The completion is matched back to its request by index.
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(
+                static_cast<quintptr>(i)));
+            count++;
+            queued += length;
+        }
+    }
+
+    if (m_ready && count > 0) {
+        submit(requests, written, count);
+    }
+
+    // Completions can arrive in any order so short writes are detected by
+    // comparing the total written.
+    for (int i = 0; i < requests.size(); i++) {
+        if (!m_ready || written.at(i) != requests.at(i).size) {
+            requests[i].ok = false;
+        }
+    }
+}
+
+bool IoUringWriteBackend::submit(QList<Request> &requests,
+    QList<qint64> &written, unsigned count)
+{
+    if (io_uring_submit(&m_ring) < 0) {
+        // The entries are still queued and point at data that is about to
+        // be released. The ring can't be used again.
+        m_ready = false;
+        return false;
+    }
+
+    // Every entry has to be reaped even if one fails so the ring can be
+    // reused.
+    for (unsigned i = 0; i < count; i++) {
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&m_ring, &cqe) < 0) {
+            m_ready = false;
+            return false;
+        }
+
+        int index = static_cast<int>(reinterpret_cast<quintptr>(
+            io_uring_cqe_get_data(cqe)));
+        if (cqe->res < 0) {
+            requests[index].ok = false;
+        }
+        else {
+            written[index] += cqe->res;
+        }
+        io_uring_cqe_seen(&m_ring, cqe);
+    }
+
+    return true;
+}
+
+int IoUringWriteBackend::getBatchSize() const
+{
+    return queueDepth;
+}
+
+bool IoUringWriteBackend::close(int handle)
+{
+    if (!m_files.contains(handle)) {
+        return false;
+    }
+    return ::close(m_files.take(handle)) == 0;
+}
+
+#endif /* HAVE_IO_URING_WRITE */
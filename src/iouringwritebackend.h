@@ -0,0 +1,101 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef IOURINGWRITEBACKEND_H
+#define IOURINGWRITEBACKEND_H
+
+#include <QtGlobal>
+
+#if defined(Q_OS_LINUX) && defined(HAVE_LIBURING) && !defined(NO_PLATFORM)
+#define HAVE_IO_URING_WRITE
+
+#include <liburing.h>
+
+#include <QHash>
+
+#include "writebackend.h"
+
+/**
+ * Writes through an io_uring submission queue.
+ *
+ * The writes DiskWriter has waiting are queued together, split into entries
+ * of at most maxSubmission bytes, and submitted and waited on with one
+ * system call. The queue is only submitted early if it fills.
+ */
+class IoUringWriteBackend : public WriteBackend
+{
+    public:
+        IoUringWriteBackend();
+        ~IoUringWriteBackend();
+
+        /**
+         * Was the ring set up.
+         *
+         * @return True if the backend can be used.
+         */
+        bool isReady() const;
+
+        QString getName() const;
+        bool open(int handle, const QString &path);
+        bool write(int handle, qint64 position, const char *data,
+            qint64 size);
+        void writeBatch(QList<Request> &requests);
+        int getBatchSize() const;
+        bool close(int handle);
+
+    private:
+        /**
+         * Submit the queued entries and wait for all of them to complete.
+         *
+         * @param requests The requests the entries belong to.
+         * @param written The bytes written for each request.
+         * @param count The number of entries queued.
+         *
+         * @return False if the entries could not be submitted.
+         */
+        bool submit(QList<Request> &requests, QList<qint64> &written,
+            unsigned count);
+
+        /**
+         * The number of entries in the submission queue.
+         */
+        static const unsigned queueDepth;
+        /**
+         * The largest write submitted in one entry.
+         */
+        static const qint64 maxSubmission;
+
+        /**
+         * The ring.
+         */
+        struct io_uring m_ring;
+        /**
+         * Whether the ring was set up.
+         */
+        bool m_ready;
+        /**
+         * The descriptors of the open files.
+         */
+        QHash<int, int> m_files;
+};
+
+#endif /* Q_OS_LINUX && HAVE_LIBURING && !NO_PLATFORM */
+
+#endif /* IOURINGWRITEBACKEND_H */
@@ -18,14 +18,22 @@
  *   <http://www.gnu.org/licenses/>.                                         *
  *****************************************************************************/
 
+#include <QFile>
+
 #include "platform.h"
 
 // Include the necessary headers for the given platform.
 #ifndef NO_PLATFORM
     #if defined(Q_OS_UNIX)
+        #include <sys/resource.h>
         #include <sys/statvfs.h>
+        #include <sys/time.h>
+        #include <fcntl.h>
+        #include <stdio.h>
+        #include <unistd.h>
     #elif defined(Q_OS_WIN32)
         #include <windows.h>
+        #include <psapi.h>
     #endif
 #endif
 
@@ -53,6 +61,157 @@ qlonglong Platform::getFreeDiskSpace(const QString &path)
     return freeSpace;
 }
 
+qlonglong Platform::getPeakMemoryUsage()
+{
+    qlonglong peak = -1;
+
+#ifndef NO_PLATFORM
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        peak = usage.ru_maxrss;
+#if defined(Q_OS_MAC)
+        // Reported in bytes instead of KB.
+        peak /= 1024;
+#endif
+    }
+#elif defined(Q_OS_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+        sizeof(counters)) != 0)
+    {
+        peak = counters.PeakWorkingSetSize / 1024;
+    }
+#endif
+#endif
+
+    return peak;
+}
+
+qlonglong Platform::getTimeMicroseconds()
+{
+    qlonglong time = -1;
+
+#ifndef NO_PLATFORM
+#if defined(Q_OS_UNIX)
+    struct timeval now;
+
+    if (gettimeofday(&now, 0) == 0) {
+        time = static_cast<qlonglong>(now.tv_sec) * 1000000 + now.tv_usec;
+    }
+#elif defined(Q_OS_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (QueryPerformanceFrequency(&frequency) != 0
+        && QueryPerformanceCounter(&counter) != 0)
+    {
+        time = counter.QuadPart / frequency.QuadPart * 1000000
+            + counter.QuadPart % frequency.QuadPart * 1000000
+            / frequency.QuadPart;
+    }
+#endif
+#endif
+
+    return time;
+}
+
+bool Platform::replaceWithHardLink(const QString &source,
+    const QString &target)
+{
+    bool linked = false;
+
+#ifndef NO_PLATFORM
+    // Link to a temporary name next to the target then move it over the
+    // target.
+    QString temporary = QString("%1.link").arg(target);
+    QFile::remove(temporary);
+
+#if defined(Q_OS_UNIX)
+    if (link(QFile::encodeName(source), QFile::encodeName(temporary)) == 0) {
+        linked = replaceFile(temporary, target);
+    }
+#elif defined(Q_OS_WIN32)
+    if (CreateHardLinkW(reinterpret_cast<const wchar_t *>(temporary.utf16()),
+        reinterpret_cast<const wchar_t *>(source.utf16()), NULL) != 0)
+    {
+        linked = replaceFile(temporary, target);
+    }
+#endif
+
+    if (!linked) {
+        QFile::remove(temporary);
+    }
+#endif
+
+    return linked;
+}
+
+bool Platform::replaceFile(const QString &source, const QString &target)
+{
+    bool replaced = false;
+
+#ifndef NO_PLATFORM
+#if defined(Q_OS_UNIX)
+    replaced = rename(QFile::encodeName(source), QFile::encodeName(target))
+        == 0;
+#elif defined(Q_OS_WIN32)
+    replaced = MoveFileExW(reinterpret_cast<const wchar_t *>(source.utf16()),
+        reinterpret_cast<const wchar_t *>(target.utf16()),
+        MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+#endif
+
+    return replaced;
+}
+
+bool Platform::syncFile(const QString &path)
+{
+    bool synced = false;
+
+#ifndef NO_PLATFORM
+#if defined(Q_OS_UNIX)
+    int fd = open(QFile::encodeName(path), O_RDONLY);
+
+    if (fd != -1) {
+        synced = fsync(fd) == 0;
+        close(fd);
+    }
+#elif defined(Q_OS_WIN32)
+    HANDLE file = CreateFileW(reinterpret_cast<const wchar_t *>(path.utf16()),
+        GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file != INVALID_HANDLE_VALUE) {
+        synced = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+    }
+#endif
+#endif
+
+    return synced;
+}
+
+bool Platform::syncDirectory(const QString &path)
+{
+    bool synced = false;
+
+#ifndef NO_PLATFORM
+#if defined(Q_OS_UNIX)
+    int fd = open(QFile::encodeName(path), O_RDONLY);
+
+    if (fd != -1) {
+        synced = fsync(fd) == 0;
+        close(fd);
+    }
+#endif
+#endif
+
+    return synced;
+}
+
 QString Platform::commandLineArgumentFlag()
 {
     QString flag = "-";
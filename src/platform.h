@@ -42,6 +42,62 @@ class Platform
          * free space is not supported on the platform.
          */
         static qlonglong getFreeDiskSpace(const QString &path);
+        /**
+         * Gets the most memory the application has used at one time.
+         *
+         * @return The peak resident memory in KB. -1 if getting the memory
+         * use is not supported on the platform.
+         */
+        static qlonglong getPeakMemoryUsage();
+        /**
+         * Gets a time stamp for measuring short intervals.
+         *
+         * @return The time in microseconds from an unspecified starting
+         * point. -1 if a precise time is not supported on the platform.
+         */
+        static qlonglong getTimeMicroseconds();
+        /**
+         * Replaces a file with a hard link to another file.
+         *
+         * The target is replaced in one step so it is never missing.
+         *
+         * @param source The existing file to link to.
+         * @param target The file to replace. It does not have to exist.
+         *
+         * @return True if the target is now a link to the source. False if
+         * hard links are not supported on the platform or file system.
+         */
+        static bool replaceWithHardLink(const QString &source,
+            const QString &target);
+        /**
+         * Renames a file replacing the target in one step.
+         *
+         * @param source The file to rename.
+         * @param target The new name. Replaced if it exists.
+         *
+         * @return True if the file was renamed. False on failure or if
+         * replacing in one step is not supported on the platform.
+         */
+        static bool replaceFile(const QString &source, const QString &target);
+        /**
+         * Forces the data of a file to be written to the disk.
+         *
+         * @param path The file.
+         *
+         * @return True if the data is on disk. False on failure or if
+         * syncing is not supported on the platform.
+         */
+        static bool syncFile(const QString &path);
+        /**
+         * Forces the entries of a directory to be written to the disk so a
+         * rename survives a crash.
+         *
+         * @param path The directory.
+         *
+         * @return True if the directory is on disk. False on failure or if
+         * syncing directories is not supported on the platform.
+         */
+        static bool syncDirectory(const QString &path);
         /**
          * Gets the platform specific command line argument prefix.
          *
@@ -18,9 +18,8 @@
  *   <http://www.gnu.org/licenses/>.                                         *
  *****************************************************************************/
 
-#include <QDomDocument>
-#include <QDomElement>
 #include <QListIterator>
+#include <QtConcurrentRun>
 
 #include "podcast.h"
 
@@ -29,6 +28,32 @@ Podcast::Podcast()
     m_category = "";
     m_init = false;
     m_ignoreNotModified = false;
+    m_decoderReady = false;
+    m_decodeFailed = false;
+    m_parseFailed = false;
+    m_feedComplete = false;
+    m_stopReading = false;
+    // The hash is only used to tell if the feed changed so the fastest
+    // algorithm is good enough.
+    m_hash = new ContentHash(ContentHash::Md5Hash);
+    m_feedHash = "";
+    m_previousFeedHash = "";
+    m_parsing = false;
+    m_replyFinished = false;
+    m_lastQueued = false;
+    m_transferredBytes = 0;
+    m_decodedBytes = 0;
+
+    connect(&m_parseWatcher, SIGNAL(finished()), this, SLOT(dataParsed()));
+}
+
+Podcast::~Podcast()
+{
+    // The parse job uses the hash.
+    waitForParse();
+
+    delete m_hash;
+    m_hash = 0;
 }
 
 bool Podcast::isInit()
@@ -46,6 +71,11 @@ QString Podcast::getCategory() const
     return m_category;
 }
 
+QUrl Podcast::getMovedUrl() const
+{
+    return m_movedUrl;
+}
+
 QList<PodcastEpisode *> Podcast::getEpisodes() const
 {
     return m_episodes;
@@ -56,6 +86,29 @@ int Podcast::getEpisodeCount()
     return m_episodes.size();
 }
 
+qint64 Podcast::getTransferredBytes() const
+{
+    return m_transferredBytes;
+}
+
+qint64 Podcast::getDecodedBytes() const
+{
+    return m_decodedBytes;
+}
+
+QString Podcast::getFeedHash() const
+{
+    return m_feedHash;
+}
+
+bool Podcast::isFeedUnchanged() const
+{
+    if (m_feedHash.isEmpty() || m_previousFeedHash.isEmpty()) {
+        return false;
+    }
+    return m_feedHash == m_previousFeedHash;
+}
+
 PodcastEpisode* Podcast::takeFirstEpisode()
 {
     if (m_episodes.size() > 0) {
@@ -79,28 +132,114 @@ void Podcast::setCategory(const QString &category)
     m_category = category;
 }
 
-void Podcast::removeEpisode(PodcastEpisode *episode)
+void Podcast::setMovedUrl(const QUrl &url)
 {
-    m_episodes.removeAll(episode);
-    delete episode;
-    episode = 0;
+    m_movedUrl = url;
 }
 
-void Podcast::truncateEpisodes(int position)
+void Podcast::setPreviousFeedHash(const QString &hash)
+{
+    m_previousFeedHash = hash;
+}
+
+void Podcast::removeEpisodes(const QSet<PodcastEpisode *> &episodes)
+{
+    if (episodes.isEmpty()) {
+        return;
+    }
+
+    QList<PodcastEpisode *> kept;
+
+    Q_FOREACH (PodcastEpisode *episode, m_episodes) {
+        if (episodes.contains(episode)) {
+            delete episode;
+            episode = 0;
+        }
+        else {
+            kept.append(episode);
+        }
+    }
+
+    m_episodes = kept;
+}
+
+void Podcast::keepNewestEpisodes(int count)
 {
     // The list should not be negative nor should this remove all episodes.
     // Use clearEpisodeList to remove all episodes.
-    if (position <= 0) {
+    if (count <= 0 || m_episodes.size() <= count) {
         return;
     }
 
-    while (m_episodes.size() > position) {
+    // Quickselect the newest count episodes to the front. Only the range
+    // holding the last kept position is partitioned further so this takes
+    // linear time on average instead of sorting the whole list.
+    int target = count - 1;
+    int left = 0;
+    int right = m_episodes.size() - 1;
+
+    while (left < right) {
+        PodcastEpisode *pivot = m_episodes.at(left + (right - left) / 2);
+        int i = left;
+        int j = right;
+
+        // Afterwards everything up to j is at least as new as the pivot and
+        // everything from i on is at most as new.
+        while (i <= j) {
+            while (PodcastEpisode::greaterThan(m_episodes.at(i), pivot)) {
+                i++;
+            }
+            while (PodcastEpisode::greaterThan(pivot, m_episodes.at(j))) {
+                j--;
+            }
+            if (i <= j) {
+                m_episodes.swap(i, j);
+                i++;
+                j--;
+            }
+        }
+
+        if (target <= j) {
+            right = j;
+        }
+        else if (target >= i) {
+            left = i;
+        }
+        // Everything between j and i is the same age as the pivot.
+        else {
+            break;
+        }
+    }
+
+    while (m_episodes.size() > count) {
         PodcastEpisode *episode = m_episodes.takeLast();
         delete episode;
         episode = 0;
     }
 }
 
+void Podcast::sortEpisodes()
+{
+    // Feeds usually list the newest episodes first already.
+    bool sorted = true;
+    for (int i = 1; i < m_episodes.size(); i++) {
+        if (PodcastEpisode::greaterThan(m_episodes.at(i),
+            m_episodes.at(i - 1)))
+        {
+            sorted = false;
+            break;
+        }
+    }
+    if (sorted) {
+        return;
+    }
+
+    // m_episodes is a list of pointers to the greaterThan function must
+    // be given otherwise qSort will sort based upon the memory address of
+    // the pointers not the episode objects.
+    qSort(m_episodes.begin(), m_episodes.end(), PodcastEpisode::greaterThan);
+}
+
 void Podcast::clearEpisodeList()
 {
     Q_FOREACH (PodcastEpisode *episode, m_episodes) {
@@ -110,91 +249,285 @@ void Podcast::clearEpisodeList()
     m_episodes.clear();
 }
 
-bool Podcast::downloadSuccessful()
+void Podcast::setNetworkReply(QNetworkReply *reply)
 {
+    // The parser is reset below so the job using it has to be done.
+    waitForParse();
+
+    if (m_reply) {
+        disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(readData()));
+        disconnect(m_reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    }
+
+    DownloadItem::setNetworkReply(reply);
+
+    // The download finishes once the feed has been parsed rather than when
+    // the reply finishes.
+    disconnect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
+
+    // A new reply, such as after a redirect, starts a new feed.
     clearEpisodeList();
+    m_parser.reset();
+    m_decoderReady = false;
+    m_decodeFailed = false;
+    m_parseFailed = false;
+    m_feedComplete = false;
+    m_stopReading = false;
+    m_hash->reset();
+    m_feedHash = "";
+    m_pendingData.clear();
+    m_replyFinished = false;
+    m_lastQueued = false;
+    // Only the reply that delivers the feed is counted. Earlier attempts
+    // would otherwise be added to the run's totals again.
+    m_transferredBytes = 0;
+    m_decodedBytes = 0;
+
+    connect(m_reply, SIGNAL(readyRead()), this, SLOT(readData()));
+    connect(m_reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+}
 
+void Podcast::stopReading()
+{
+    m_stopReading = true;
+}
+
+bool Podcast::isStoppedEarly() const
+{
+    return m_stopReading;
+}
+
+void Podcast::readData()
+{
+    queueData();
+    parseNext();
+}
+
+void Podcast::replyFinished()
+{
     if (!m_reply) {
-        return false;
+        return;
     }
 
-    QDomDocument document;
-    QString errorMsg;
-    int errorLine;
-    int errorColumn;
+    // Errors, redirects and not modified responses do not need the parser.
+    if (m_reply->error() != QNetworkReply::NoError || m_reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+    {
+        downloadFinished();
+        return;
+    }
 
-    if (!document.setContent(m_reply, &errorMsg, &errorLine, &errorColumn)) {
-        emit error(this, tr("Could not parse %1 because %2 at line %3 and"
-            " column %4.").arg(getName()).arg(errorMsg).arg(errorLine)
-            .arg(errorColumn));
-        return false;
+    // Anything that has not been read yet.
+    queueData();
+    m_replyFinished = true;
+    // Nothing more will be received so the reply can't stall while the
+    // rest of the feed is parsed.
+    stopWatchdog();
+    parseNext();
+}
+
+void Podcast::dataParsed()
+{
+    // A job from a download that has since been cleaned up.
+    if (!m_parsing) {
+        return;
     }
+    m_parsing = false;
 
-    QDomElement rootElement = document.firstChildElement("rss");
-    if (rootElement.isNull()) {
-        emit error(this, tr("Rss element <rss> not found in podcast feed for"
-            " %1.").arg(getName()));
-        return false;
+    addParsedEpisodes();
+
+    // The episodes that are needed have been parsed. Treat what has been
+    // read as the whole feed.
+    if (m_stopReading) {
+        completeDownload();
+        return;
     }
-    QDomElement channelElement = rootElement.firstChildElement("channel");
-    if (channelElement.isNull()) {
-        emit error(this, tr("Rss element <channel> not found in podcast feed"
-            " for %1.").arg(getName()));
-        return false;
+    // The whole feed has been parsed.
+    if (m_lastQueued) {
+        downloadFinished();
+        return;
     }
 
-    QDomElement itemElement = channelElement.firstChildElement("item");
+    parseNext();
+}
 
-    while (!itemElement.isNull()) {
-        QDomElement dataElement = itemElement.firstChildElement();
+void Podcast::queueData()
+{
+    if (!m_reply) {
+        return;
+    }
 
-        PodcastEpisode *episode = new PodcastEpisode();
+    QByteArray data = m_reply->readAll();
 
-        while (!dataElement.isNull()) {
-            if (dataElement.tagName().trimmed().toLower() == "title") {
-                episode->setName(dataElement.text());
-            }
-            else if (dataElement.tagName().trimmed().toLower() == "pubdate") {
-                QString pubdate = dataElement.text().trimmed();
-                pubdate.truncate(pubdate.lastIndexOf(" "));
-                episode->setPublishDate(QDateTime::fromString(
-                    pubdate, "ddd, dd MMM yyyy HH:mm:ss"));
-            }
-            else if (dataElement.tagName().trimmed().toLower() == "enclosure")
-            {
-                episode->setUrl(QUrl(dataElement.attribute("url")));
-            }
-            else if (dataElement.tagName().trimmed().toLower()
-                == "itunes:explicit")
-            {
-                // We want to be conservative. If it's not no it's assumed to
-                // be yes. We don't need to set the explicit status to false
-                // because false is the default status for an episode.
-                if (dataElement.attribute("url") != "no") {
-                    episode->setExplicit(true);
-                }
-            }
+    // Only the feed itself is decoded. Redirects and error pages are not.
+    if (m_stopReading || m_reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+    {
+        return;
+    }
 
-            dataElement = dataElement.nextSiblingElement();
+    // No job has been started for this reply yet so the decoder is not in
+    // use.
+    if (!m_decoderReady) {
+        m_decoderReady = true;
+        if (!m_decoder.reset(StreamDecoder::encodingFromHeader(
+            m_reply->rawHeader("Content-Encoding"))))
+        {
+            m_decodeFailed = true;
         }
+    }
 
-        if (episode->getUrl().isEmpty() || !episode->getUrl().isValid()) {
-            delete episode;
-            episode = 0;
+    m_transferredBytes += data.size();
+    m_pendingData.append(data);
+}
+
+void Podcast::parseNext()
+{
+    // One job runs at a time so the feed is parsed in order. Data that
+    // arrives in the meantime is parsed by the next job.
+    if (m_parsing || m_lastQueued) {
+        return;
+    }
+    if (m_pendingData.isEmpty() && !m_replyFinished) {
+        return;
+    }
+
+    m_parsing = true;
+    m_lastQueued = m_replyFinished;
+    // The global thread pool has a thread for each core.
+    m_parseWatcher.setFuture(QtConcurrent::run(this, &Podcast::parseData,
+        m_pendingData, m_lastQueued));
+    m_pendingData.clear();
+}
+
+void Podcast::parseData(const QByteArray &data, bool last)
+{
+    if (m_decodeFailed) {
+        return;
+    }
+
+    QByteArray decoded;
+
+    if (!m_decoder.decode(data, &decoded)) {
+        m_decodeFailed = true;
+    }
+
+    m_decodedBytes += decoded.size();
+    m_hash->addData(decoded.constData(), decoded.size());
+
+    // The feed is parsed as it arrives so it never has to be held in memory
+    // as a whole.
+    if (!m_parseFailed && !m_parser.addData(decoded)) {
+        m_parseFailed = true;
+    }
+    if (last && !m_parseFailed && !m_parser.finish()) {
+        m_parseFailed = true;
+    }
+}
+
+void Podcast::waitForParse()
+{
+    m_parseWatcher.waitForFinished();
+    m_parsing = false;
+}
+
+void Podcast::addParsedEpisodes()
+{
+    Q_FOREACH (FeedItem item, m_parser.takeItems()) {
+        // The rest of the feed is not wanted.
+        if (m_stopReading) {
+            break;
         }
-        else {
-            m_episodes.append(episode);
+
+        QUrl url(item.url);
+        if (url.isEmpty() || !url.isValid()) {
+            continue;
         }
 
-        itemElement = itemElement.nextSiblingElement("item");
+        PodcastEpisode *episode = new PodcastEpisode();
+        episode->setPodcastUrl(getUrl());
+        episode->setName(item.title);
+        episode->setPublishTime(item.publishTime);
+        episode->setUrl(url);
+        episode->setEnclosureLength(item.length);
+        episode->setGuid(item.guid);
+        // Episodes are not explicit by default.
+        if (item.isExplicit) {
+            episode->setExplicit(true);
+        }
+
+        m_episodes.append(episode);
+        emit episodeParsed(this, episode);
     }
+}
 
-    // Sort the episodes so that the most recent are first. This is done so
-    // that truncateEpisodes removes older episodes rather than newer ones.
-    // m_episodes is a list of pointers to the greaterThan function must
-    // be given otherwise qSort will sort based upon the memory address of
-    // the pointers not the episode objects.
-    qSort(m_episodes.begin(), m_episodes.end(), PodcastEpisode::greaterThan);
+bool Podcast::downloadSuccessful()
+{
+    if (!m_reply) {
+        return false;
+    }
+
+    // The parse jobs have finished by the time this is called.
+    if (m_decodeFailed) {
+        emit error(this, tr("Could not decode %1 because %2.").arg(getName())
+            .arg(m_decoder.errorString()));
+        return false;
+    }
+
+    // A response that was never given to the parser, such as a 206, is
+    // still checked so it is reported as not being a feed.
+    if (!m_stopReading
+        && (m_parseFailed || (!m_lastQueued && !m_parser.finish())))
+    {
+        switch (m_parser.getError()) {
+            case FeedParser::NoRssError:
+                emit error(this, tr("Rss element <rss> not found in podcast"
+                    " feed for %1.").arg(getName()));
+                break;
+            case FeedParser::NoChannelError:
+                emit error(this, tr("Rss element <channel> not found in"
+                    " podcast feed for %1.").arg(getName()));
+                break;
+            default:
+                emit error(this, tr("Could not parse %1 because %2 at line %3"
+                    " and column %4.").arg(getName())
+                    .arg(m_parser.errorString()).arg(m_parser.getErrorLine())
+                    .arg(m_parser.getErrorColumn()));
+                break;
+        }
+        return false;
+    }
+    m_feedComplete = true;
+
+    // Only a feed that was read to the end can be compared with the last
+    // download.
+    if (!m_stopReading) {
+        m_feedHash = m_hash->result();
+    }
 
     return true;
 }
+
+void Podcast::cleanDownload()
+{
+    if (m_reply) {
+        disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(readData()));
+        disconnect(m_reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    }
+    // The parser is reset below so the job using it has to be done.
+    waitForParse();
+    // Episodes from a feed that did not finish downloading are dropped.
+    // Otherwise they are kept and only the parser's state is freed.
+    if (!m_feedComplete) {
+        clearEpisodeList();
+    }
+    m_parser.reset();
+    m_pendingData.clear();
+
+    // The rest of a feed that was stopped early is not downloaded.
+    if (m_reply && m_stopReading) {
+        m_reply->abort();
+    }
+
+    DownloadItem::cleanDownload();
+}
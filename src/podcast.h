@@ -21,10 +21,17 @@
 #ifndef PODCAST_H
 #define PODCAST_H
 
+#include <QByteArray>
+#include <QFutureWatcher>
 #include <QList>
+#include <QSet>
+#include <QUrl>
 
+#include "contenthash.h"
 #include "downloaditem.h"
+#include "feedparser.h"
 #include "podcastepisode.h"
+#include "streamdecoder.h"
 
 /**
  * A representation of a podcast.
@@ -41,6 +48,7 @@ class Podcast : public DownloadItem
 
     public:
         Podcast();
+        ~Podcast();
 
         /**
          * Has the podcast been set to init mode.
@@ -60,7 +68,7 @@ class Podcast : public DownloadItem
          * Should the not modified response form the server be ignored.
          *
          * This is dependant on the Last-Modified and If-Modified-Since
-         * headers. Not all servers report the Last-Modified header and not
+         * headers as well as the ETag and If-None-Match headers. Not all servers report the Last-Modified header and not
          * all servers report it correctly. Therefore this can be disabled on
          * a per podcast basis if necessary.
          *
@@ -76,6 +84,12 @@ class Podcast : public DownloadItem
          * @return The category. An empty string if no category has been set.
          */
         QString getCategory() const;
+        /**
+         * Gets the url the rss feed permanently moved to on a previous run.
+         *
+         * @return The url. An empty url if the feed has not moved.
+         */
+        QUrl getMovedUrl() const;
 
         /**
          * Gets a list of episodes.
@@ -92,6 +106,37 @@ class Podcast : public DownloadItem
          * @return The total number of episodes avaliable.
          */
         int getEpisodeCount();
+        /**
+         * Gets the number of bytes of the rss feed that were transferred.
+         *
+         * This is the size of the feed before it was decompressed.
+         *
+         * @return The number of bytes transferred.
+         */
+        qint64 getTransferredBytes() const;
+        /**
+         * Gets the size of the rss feed after it was decompressed.
+         *
+         * @return The number of decoded bytes.
+         */
+        qint64 getDecodedBytes() const;
+        /**
+         * Gets the hash of the decoded rss feed.
+         *
+         * @return The hash. An empty string if the whole feed was not
+         * read.
+         */
+        QString getFeedHash() const;
+        /**
+         * Is the rss feed the same as the last time it was downloaded.
+         *
+         * Some servers ignore If-Modified-Since and If-None-Match and always
+         * send the whole feed. The feed is treated as not modified when its
+         * hash matches the one set with setPreviousFeedHash.
+         *
+         * @return True if the whole feed was read and its hash matches.
+         */
+        bool isFeedUnchanged() const;
         /**
          * Removes the first podcast episode and returns it.
          *
@@ -124,26 +169,53 @@ class Podcast : public DownloadItem
          * @param category The category of the podcast.
          */
         void setCategory(const QString &category);
+        /**
+         * Sets the url the rss feed permanently moved to on a previous run.
+         *
+         * This is loaded once from the database so it does not have to be
+         * looked up every time the podcast is considered for download.
+         *
+         * @param url The url. An empty url if the feed has not moved.
+         */
+        void setMovedUrl(const QUrl &url);
+        /**
+         * Sets the hash of the rss feed from the last time it was
+         * downloaded.
+         *
+         * @param hash The hash. An empty string if the feed should not be
+         * compared.
+         *
+         * @see isFeedUnchanged
+         */
+        void setPreviousFeedHash(const QString &hash);
 
         /**
-         * Remove the episode from the episode list.
+         * Remove episodes from the episode list.
          *
          * This is used in conjunction with previously downloaded episodes.
-         * This will delete the episode object. It will also remove the
-         * episode object from the list.
+         * The list is rebuilt in one pass. This will delete the episode
+         * objects that are removed.
          *
-         * @param *episode The episode to remove
+         * @param episodes The episodes to remove.
          */
-        void removeEpisode(PodcastEpisode *episode);
+        void removeEpisodes(const QSet<PodcastEpisode *> &episodes);
         /**
-         * Removes all episodes after position from the episode list.
+         * Removes all but the newest episodes from the episode list.
          *
-         * If position is larger than the episode list no episodes are removed.
-         * This will delete all episode objects removed from the list.
+         * Only the kept episodes are moved to the front, the list is not
+         * sorted. If count is not smaller than the episode list no episodes
+         * are removed. This will delete all episode objects removed from
+         * the list.
+         *
+         * @param count The number of episodes to keep.
          *
-         * @param position The position to remove from.
+         * @see sortEpisodes
          */
-        void truncateEpisodes(int position);
+        void keepNewestEpisodes(int count);
+        /**
+         * Sorts the episode list so the most recent episodes are first.
+         */
+        void sortEpisodes();
         /**
          * Removes all episode from the episode list.
          *
@@ -151,38 +223,200 @@ class Podcast : public DownloadItem
          */
         void clearEpisodeList();
 
-    protected:
         /**
-         * Parses the RSS associated with the podcast and creates a list of
-         * episodes.
+         * Sets the network reply used for downloading the rss feed.
+         *
+         * @param *reply The network reply returned by a QNetworkAccessManager
+         * object.
+         *
+         * @see DownloadItem::setNetworkReply
+         */
+        void setNetworkReply(QNetworkReply *reply);
+        /**
+         * Stop downloading the rss feed once the episode being parsed has
+         * been added.
+         *
+         * What has been parsed is used as the whole feed. The rest of the
+         * feed is not downloaded and the finished signal is emitted.
+         *
+         * This is meant to be called from a slot connected to
+         * episodeParsed.
+         */
+        void stopReading();
+        /**
+         * Was the rss feed stopped before all of it was downloaded.
+         *
+         * @return True if stopReading was called for the current download.
+         */
+        bool isStoppedEarly() const;
+
+    signals:
+        /**
+         * This signal is emitted when an episode has been parsed and added
+         * to the episode list.
+         *
+         * The episodes are in the order they are listed in the feed.
+         *
+         * @param item this.
+         * @param episode The episode.
+         *
+         * @see stopReading
+         */
+        void episodeParsed(DownloadItem *item, PodcastEpisode *episode);
+
+    private slots:
+        /**
+         * Queue the data that has been downloaded to be decoded and parsed.
+         *
+         * The feed is decompressed as it arrives if the server sent it with
+         * a gzip or deflate content encoding. Decoding and parsing run on
+         * the global thread pool so a large feed does not hold up the other
+         * downloads.
+         */
+        void readData();
+        /**
+         * The network reply has finished.
+         *
+         * The download is finished once the rest of the feed has been
+         * parsed.
+         */
+        void replyFinished();
+        /**
+         * A parse job has finished.
          *
-         * This will clear the current episode list and delete all episode
-         * objects. Do no call this slot if episodes in the list are being
-         * used elsewhere. This only matters if the episode is referenced by
-         * podcast's episode list. If the episode has been removed from the
-         * list this will have no effect on the episode.
+         * Episodes are added to the episode list as soon as their item has
+         * been parsed.
+         */
+        void dataParsed();
+
+    protected:
+        /**
+         * Checks the RSS associated with the podcast was parsed.
          *
-         * If the episode list has been modifed by other functions this will
-         * clear those changes.
+         * The episode list is built while the feed downloads and is in the
+         * order of the feed. Setting a new
+         * network reply clears it and deletes all episode objects. Do not
+         * start a new download if episodes in the list are being used
+         * elsewhere. If the feed cannot be parsed the list is cleared.
          *
          * @return True on success. False if there was an error.
          *
-         * @see removeEpisode
-         * @see truncateEpisodes
+         * @see removeEpisodes
+         * @see keepNewestEpisodes
          */
         bool downloadSuccessful();
+        void cleanDownload();
 
     private:
+        /**
+         * Read the data that has been downloaded into m_pendingData.
+         */
+        void queueData();
+        /**
+         * Start a parse job for m_pendingData if one is not running.
+         */
+        void parseNext();
+        /**
+         * Decode and parse part of the feed.
+         *
+         * This runs on a pool thread. Nothing else uses the decoder, parser
+         * or hash while it runs.
+         *
+         * @param data The data as it was downloaded.
+         * @param last True if this is the end of the feed.
+         */
+        void parseData(const QByteArray &data, bool last);
+        /**
+         * Block until the running parse job, if any, has finished.
+         */
+        void waitForParse();
+        /**
+         * Add the items the parser has finished to the episode list.
+         */
+        void addParsedEpisodes();
+
         /**
          * The podcast's category.
          *
          * This can be empty.
          */
         QString m_category;
+        /**
+         * The url the rss feed permanently moved to on a previous run.
+         */
+        QUrl m_movedUrl;
         /**
          * The list of episode associated with the podcast.
          */
         QList<PodcastEpisode *> m_episodes;
+        /**
+         * Parses the decoded rss feed.
+         */
+        FeedParser m_parser;
+        /**
+         * Whether the rss feed could not be parsed.
+         */
+        bool m_parseFailed;
+        /**
+         * Whether the whole rss feed has been parsed.
+         */
+        bool m_feedComplete;
+        /**
+         * Whether the rest of the rss feed should not be read.
+         */
+        bool m_stopReading;
+        /**
+         * Watches the running parse job.
+         */
+        QFutureWatcher<void> m_parseWatcher;
+        /**
+         * Data that has been downloaded but not given to a parse job.
+         */
+        QByteArray m_pendingData;
+        /**
+         * Whether a parse job is running.
+         */
+        bool m_parsing;
+        /**
+         * Whether the network reply has finished.
+         */
+        bool m_replyFinished;
+        /**
+         * Whether the end of the feed has been given to a parse job.
+         */
+        bool m_lastQueued;
+        /**
+         * Hashes the decoded rss feed as it is read.
+         */
+        ContentHash *m_hash;
+        /**
+         * The hash of the whole rss feed.
+         */
+        QString m_feedHash;
+        /**
+         * The hash of the rss feed from the last time it was downloaded.
+         */
+        QString m_previousFeedHash;
+        /**
+         * Decompresses the rss feed.
+         */
+        StreamDecoder m_decoder;
+        /**
+         * Whether the decoder has been set up for the current reply.
+         */
+        bool m_decoderReady;
+        /**
+         * Whether the rss feed could not be decoded.
+         */
+        bool m_decodeFailed;
+        /**
+         * The number of bytes of the rss feed that were transferred.
+         */
+        qint64 m_transferredBytes;
+        /**
+         * The number of bytes of the rss feed after decoding.
+         */
+        qint64 m_decodedBytes;
         /**
          * Init mode.
          */
@@ -18,30 +18,79 @@
  *   <http://www.gnu.org/licenses/>.                                         *
  *****************************************************************************/
 
+#include <QFileInfo>
+
+#include "platform.h"
 #include "podcastepisode.h"
 
+// Large enough to keep a fast connection busy between reads but small
+// enough that throttled data stays in the socket.
+const qint64 PodcastEpisode::readBufferSize = 262144;
+const qint64 PodcastEpisode::throttledReadBufferSize = 65536;
+const int PodcastEpisode::fallbackBufferSize = 65536;
+
 PodcastEpisode::PodcastEpisode()
 {
     m_file = 0;
+    m_bandwidthLimiter = 0;
+    m_bufferPool = 0;
+    m_diskWriter = 0;
+    m_writeHandle = -1;
+    m_hash = 0;
+    m_hashedPosition = 0;
+    m_fileSize = -1;
     m_explicit = false;
+    m_publishTime = -1;
+    m_enclosureLength = -1;
+    m_contentLength = -1;
+    m_acceptRanges = false;
+    m_writePosition = 0;
+    m_segmentEnd = -1;
+    m_segmentCount = 0;
+    m_headersProcessed = false;
+    m_writeEnabled = false;
+    m_discardPartial = false;
+    m_hedgeReply = 0;
+    m_hedgeDelay = 0;
+    m_responseDelay = -1;
+
+    m_hedgeTimer.setSingleShot(true);
+    connect(&m_hedgeTimer, SIGNAL(timeout()), this, SLOT(requestHedge()));
 }
 
 PodcastEpisode::~PodcastEpisode()
 {
+    // The partial file is intentionally left on disk so an unfinished
+    // download can be resumed.
+    clearSegments();
+    closeWriteHandle();
+
     if (m_file) {
         m_file->close();
         delete m_file;
     }
+
+    delete m_hash;
+}
+
+qint64 PodcastEpisode::getPublishTime() const
+{
+    return m_publishTime;
+}
+
+void PodcastEpisode::setPublishTime(qint64 time)
+{
+    m_publishTime = time;
 }
 
-QDateTime PodcastEpisode::getPublishDate() const
+qint64 PodcastEpisode::getEnclosureLength() const
 {
-    return m_publishDate;
+    return m_enclosureLength;
 }
 
-void PodcastEpisode::setPublishDate(const QDateTime &date)
+void PodcastEpisode::setEnclosureLength(qint64 length)
 {
-    m_publishDate = date;
+    m_enclosureLength = length;
 }
 
 QString PodcastEpisode::getSaveLocation() const
@@ -49,22 +98,130 @@ QString PodcastEpisode::getSaveLocation() const
     return m_fileName;
 }
 
+QString PodcastEpisode::getPartialSaveLocation() const
+{
+    return QString("%1.part").arg(m_fileName);
+}
+
+QUrl PodcastEpisode::getPodcastUrl() const
+{
+    return m_podcastUrl;
+}
+
+QString PodcastEpisode::getGuid() const
+{
+    return m_guid;
+}
+
+qint64 PodcastEpisode::getResumeOffset() const
+{
+    if (m_file) {
+        return m_file->size();
+    }
+    return 0;
+}
+
+QString PodcastEpisode::getValidator() const
+{
+    return m_validator;
+}
+
+qint64 PodcastEpisode::getContentLength() const
+{
+    return m_contentLength;
+}
+
+QUrl PodcastEpisode::getDownloadUrl() const
+{
+    if (m_reply) {
+        return m_reply->url();
+    }
+    return getUrl();
+}
+
+bool PodcastEpisode::isRangeSupported() const
+{
+    return m_writeEnabled && m_writePosition == 0 && m_acceptRanges
+        && m_contentLength > 0 && !m_validator.isEmpty();
+}
+
+int PodcastEpisode::getSegmentCount() const
+{
+    return m_segmentCount;
+}
+
+QString PodcastEpisode::getContentHash() const
+{
+    return m_contentHash;
+}
+
+QString PodcastEpisode::getHashAlgorithm() const
+{
+    if (m_hash) {
+        return ContentHash::algorithmName(m_hash->getAlgorithm());
+    }
+    return QString();
+}
+
+qint64 PodcastEpisode::getFileSize() const
+{
+    return m_fileSize;
+}
+
+QString PodcastEpisode::getContentETag() const
+{
+    return m_contentETag;
+}
+
+QString PodcastEpisode::getLinkedFrom() const
+{
+    return m_linkedFrom;
+}
+
+QNetworkRequest PodcastEpisode::getRequest() const
+{
+    if (m_reply) {
+        return m_reply->request();
+    }
+    return QNetworkRequest();
+}
+
+int PodcastEpisode::getResponseDelay() const
+{
+    return m_responseDelay;
+}
+
 void PodcastEpisode::setSaveLocation(const QString &fileName)
 {
     m_fileName = fileName;
+    m_linkedFrom.clear();
+    m_discardPartial = false;
+    closeWriteHandle();
+    resetHash();
 
     if (m_file) {
         m_file->close();
         delete m_file;
     }
 
-    m_file = new QFile(m_fileName);
-    if (!m_file->open(QIODevice::WriteOnly)) {
+    // Open without truncating so data from a previous attempt is kept.
+    m_file = new QFile(getPartialSaveLocation());
+    if (!m_file->open(QIODevice::ReadWrite)) {
         delete m_file;
         m_file = 0;
     }
 }
 
+void PodcastEpisode::setPodcastUrl(const QUrl &url)
+{
+    m_podcastUrl = url;
+}
+
+void PodcastEpisode::setGuid(const QString &guid)
+{
+    m_guid = guid;
+}
+
 bool PodcastEpisode::isExplicit()
 {
     return m_explicit;
@@ -77,49 +234,815 @@ void PodcastEpisode::setExplicit(bool isExplicit)
 
 void PodcastEpisode::resetWrite()
 {
+    closeWriteHandle();
+    resetHash();
+
     if (m_file) {
+        m_file->resize(0);
         m_file->reset();
     }
 }
 
+void PodcastEpisode::setBufferPool(BufferPool *pool)
+{
+    m_bufferPool = pool;
+}
+
+void PodcastEpisode::setDiskWriter(DiskWriter *writer)
+{
+    closeWriteHandle();
+
+    if (m_diskWriter) {
+        disconnect(m_diskWriter, SIGNAL(writesCompleted()), this,
+            SLOT(readPendingData()));
+    }
+
+    m_diskWriter = writer;
+
+    // Data left in the replies when the buffers ran out is read once some
+    // have been written.
+    if (m_diskWriter) {
+        connect(m_diskWriter, SIGNAL(writesCompleted()), this,
+            SLOT(readPendingData()));
+    }
+}
+
+void PodcastEpisode::setHashAlgorithm(ContentHash::Algorithm algorithm)
+{
+    delete m_hash;
+    m_hash = 0;
+
+    if (algorithm != ContentHash::NoHash) {
+        m_hash = new ContentHash(algorithm);
+    }
+    resetHash();
+}
+
+void PodcastEpisode::setHedgeDelay(int delay)
+{
+    m_hedgeDelay = qMax(delay, 0);
+}
+
+void PodcastEpisode::setBandwidthLimiter(BandwidthLimiter *limiter)
+{
+    if (m_bandwidthLimiter) {
+        disconnect(m_bandwidthLimiter, SIGNAL(bytesAvailable()), this,
+            SLOT(readPendingData()));
+    }
+
+    m_bandwidthLimiter = limiter;
+
+    if (m_bandwidthLimiter) {
+        connect(m_bandwidthLimiter, SIGNAL(bytesAvailable()), this,
+            SLOT(readPendingData()));
+    }
+}
+
+void PodcastEpisode::setSegmentEnd(qint64 end)
+{
+    m_segmentEnd = end;
+}
+
+bool PodcastEpisode::linkExisting(const QString &path)
+{
+    if (!Platform::replaceWithHardLink(path, m_fileName)) {
+        return false;
+    }
+
+    m_linkedFrom = path;
+    m_fileSize = QFileInfo(path).size();
+
+    m_discardPartial = true;
+    cleanDownload();
+    return true;
+}
+
+void PodcastEpisode::addSegment(QNetworkReply *reply, qint64 start,
+    qint64 end)
+{
+    EpisodeSegment *segment = new EpisodeSegment(reply, start, end);
+    m_segments.append(segment);
+    m_segmentCount++;
+
+    reply->setParent(this);
+    reply->setObjectName(QString("segment reply for: %1").arg(getName()));
+    // Data the bandwidth limiter holds back or that has not been written
+    // yet should stay in the socket rather than building up in the reply.
+    reply->setReadBufferSize(m_bandwidthLimiter ? throttledReadBufferSize
+        : readBufferSize);
+
+    connect(reply, SIGNAL(readyRead()), this, SLOT(writeSegmentData()));
+    connect(reply, SIGNAL(finished()), this, SLOT(segmentFinished()));
+    // Data arriving on any segment keeps the download from being seen as
+    // stalled.
+    watchReply(reply);
+    connect(reply, SIGNAL(sslErrors(const QList<QSslError> &)), reply,
+        SLOT(ignoreSslErrors()));
+}
+
+void PodcastEpisode::setHedgeReply(QNetworkReply *reply)
+{
+    clearHedge();
+
+    m_hedgeReply = reply;
+    m_hedgeReply->setParent(this);
+    m_hedgeReply->setObjectName(QString("hedge reply for: %1")
+        .arg(getName()));
+
+    connect(m_hedgeReply, SIGNAL(metaDataChanged()), this,
+        SLOT(hedgeResponded()));
+    connect(m_hedgeReply, SIGNAL(finished()), this, SLOT(hedgeFinished()));
+    connect(m_hedgeReply, SIGNAL(sslErrors(const QList<QSslError> &)),
+        m_hedgeReply, SLOT(ignoreSslErrors()));
+}
+
 void PodcastEpisode::setNetworkReply(QNetworkReply *reply)
+{
+    clearHedge();
+    installReply(reply);
+
+    // Ask for a second request if the server is slow to respond.
+    m_requestTime.start();
+    m_responseDelay = -1;
+    if (m_hedgeDelay > 0) {
+        m_hedgeTimer.start(m_hedgeDelay);
+    }
+}
+
+void PodcastEpisode::installReply(QNetworkReply *reply)
 {
     // This function is nearly identical to it's base class DownloadItem.
-    // Except, for the addition of the readyRead signal from m_reply beining
-    // handled.
+    // Except, for the addition of the readyRead and metaDataChanged signals
+    // from m_reply beining handled.
 
     if (m_reply) {
         disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(writeData()));
+        disconnect(m_reply, SIGNAL(metaDataChanged()), this,
+            SLOT(processHeaders()));
         disconnect(m_reply, SIGNAL(finished()), this,
             SLOT(downloadFinished()));
         m_reply->deleteLater();
     }
 
     m_reply = reply;
+    setFailure(PermanentFailure);
     m_reply->setParent(this);
     m_reply->setObjectName(QString("reply for: %1").arg(getName()));
+    m_reply->setReadBufferSize(m_bandwidthLimiter ? throttledReadBufferSize
+        : readBufferSize);
 
+    m_contentLength = -1;
+    m_acceptRanges = false;
+    m_writePosition = 0;
+    m_segmentEnd = -1;
+    m_segmentCount = 0;
+    m_headersProcessed = false;
+    m_writeEnabled = false;
+
+    connect(m_reply, SIGNAL(metaDataChanged()), this,
+        SLOT(processHeaders()));
     connect(m_reply, SIGNAL(readyRead()), this, SLOT(writeData()));
     connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
     connect(m_reply, SIGNAL(sslErrors(const QList<QSslError> &)), m_reply,
         SLOT(ignoreSslErrors()));
+
+    startWatchdog();
+}
+
+void PodcastEpisode::requestHedge()
+{
+    if (m_reply && !m_headersProcessed && !m_hedgeReply) {
+        emit hedgeRequested(this);
+    }
+}
+
+void PodcastEpisode::hedgeResponded()
+{
+    if (sender() == m_hedgeReply && !m_hedgeReply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).isNull())
+    {
+        useHedgeReply();
+    }
+}
+
+void PodcastEpisode::hedgeFinished()
+{
+    if (!m_hedgeReply || sender() != m_hedgeReply) {
+        return;
+    }
+
+    // A second request that could not connect leaves the first one to
+    // carry on.
+    if (m_hedgeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+        .isNull())
+    {
+        clearHedge();
+        return;
+    }
+
+    // The finished signal has already been emitted so the download has to
+    // be finished here.
+    QNetworkReply *reply = m_hedgeReply;
+    useHedgeReply();
+    if (m_reply == reply) {
+        downloadFinished();
+    }
+}
+
+void PodcastEpisode::useHedgeReply()
+{
+    QNetworkReply *reply = m_hedgeReply;
+    m_hedgeReply = 0;
+    m_hedgeTimer.stop();
+    disconnect(reply, 0, this, 0);
+
+    // The first request is no longer needed. Its signals are disconnected
+    // first because aborting emits finished.
+    disconnect(m_reply, 0, this, 0);
+    m_reply->abort();
+
+    installReply(reply);
+    emit hedgeResolved(this, true);
+
+    // The signals for the headers and any data that has arrived were
+    // emitted before the reply was connected.
+    processHeaders();
+    if (m_reply == reply && m_reply->bytesAvailable() > 0) {
+        writeData();
+    }
+}
+
+void PodcastEpisode::clearHedge()
+{
+    m_hedgeTimer.stop();
+    if (!m_hedgeReply) {
+        return;
+    }
+
+    disconnect(m_hedgeReply, 0, this, 0);
+    m_hedgeReply->abort();
+    m_hedgeReply->deleteLater();
+    m_hedgeReply = 0;
+
+    emit hedgeResolved(this, false);
 }
 
 void PodcastEpisode::writeData()
 {
-    if (m_file && m_file->isOpen()) {
-        m_file->write(m_reply->readAll());
+    // The first connection of a segmented download may have been the last
+    // part of the episode to finish.
+    if (writeReplyData(true) && isSegmentsComplete()) {
+        completeDownload();
     }
-    else {
+}
+
+void PodcastEpisode::writeSegmentData()
+{
+    EpisodeSegment *segment = findSegment(sender());
+    if (segment) {
+        writeSegment(segment, true);
+    }
+}
+
+void PodcastEpisode::readPendingData()
+{
+    if (m_reply && m_writeEnabled && m_reply->bytesAvailable() > 0) {
+        writeData();
+    }
+
+    // Writing can fail and remove the segments.
+    for (int i = 0; i < m_segments.size(); i++) {
+        if (m_segments.at(i)->getNetworkReply()->bytesAvailable() > 0) {
+            writeSegment(m_segments.at(i), true);
+        }
+    }
+}
+
+void PodcastEpisode::segmentFinished()
+{
+    EpisodeSegment *segment = findSegment(sender());
+    if (!segment) {
+        return;
+    }
+
+    // Anything held back by the bandwidth limiter still needs to be written.
+    writeSegment(segment, false);
+    if (!m_segments.contains(segment)) {
+        return;
+    }
+
+    if (!segment->isComplete()) {
+        setFailure(segment->getNetworkReply());
+        cleanDownload();
+        emit error(this, tr("Connection failed while downloading a"
+            " segment."));
+        return;
+    }
+
+    // The first connection stops reading once its segment has been written.
+    if (!m_writeEnabled && isSegmentsComplete()) {
+        completeDownload();
+    }
+}
+
+bool PodcastEpisode::writeReplyData(bool throttle)
+{
+    if (!m_reply) {
+        return false;
+    }
+
+    if (!m_file || !m_file->isOpen()) {
         cleanDownload();
         emit error(this, tr("File %1 could not opened for writing.")
-            .arg(m_fileName));
+            .arg(getPartialSaveLocation()));
+        return false;
+    }
+
+    // metaDataChanged should always come first but make sure the headers
+    // have been looked at before anything is written.
+    if (!m_headersProcessed) {
+        processHeaders();
+        if (!m_reply) {
+            return false;
+        }
+    }
+
+    // Redirects and error pages have a body that is not part of the episode.
+    if (!m_writeEnabled) {
+        m_reply->readAll();
+        return false;
+    }
+
+    // The first connection of a segmented download stops at the end of its
+    // segment. The rest of the data is being downloaded by the segments.
+    qint64 written = transferData(m_reply, m_writePosition, m_segmentEnd,
+        throttle);
+    if (written < 0) {
+        cleanDownload();
+        emit error(this, tr("Could not write to file %1.")
+            .arg(getPartialSaveLocation()));
+        return false;
+    }
+    m_writePosition += written;
+
+    if (m_segmentEnd >= 0 && m_writePosition > m_segmentEnd) {
+        disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(writeData()));
+        disconnect(m_reply, SIGNAL(finished()), this,
+            SLOT(downloadFinished()));
+        m_reply->abort();
+        m_writeEnabled = false;
+        return true;
+    }
+
+    return false;
+}
+
+void PodcastEpisode::writeSegment(EpisodeSegment *segment, bool throttle)
+{
+    QNetworkReply *reply = segment->getNetworkReply();
+
+    // A server that ignores the range, or the file changing since the first
+    // connection started, would corrupt the episode.
+    if (!segment->isAccepted()) {
+        QByteArray range = reply->rawHeader("Content-Range");
+
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+            .toInt() != 206
+            || !range.startsWith(QString("bytes %1-")
+            .arg(segment->getStart()).toAscii()))
+        {
+            m_discardPartial = true;
+            setFailure(TransientFailure);
+            cleanDownload();
+            emit error(this, tr("Server did not send the requested range for"
+                " a segment."));
+            return;
+        }
+        segment->setAccepted(true);
+    }
+
+    qint64 written = transferData(reply, segment->getPosition(),
+        segment->getEnd(), throttle);
+    if (written < 0) {
+        cleanDownload();
+        emit error(this, tr("Could not write to file %1.")
+            .arg(getPartialSaveLocation()));
+        return;
+    }
+    segment->setPosition(segment->getPosition() + written);
+}
+
+qint64 PodcastEpisode::getReadSize(QNetworkReply *reply, bool throttle,
+    qint64 limit)
+{
+    qint64 available = reply->bytesAvailable();
+    if (limit >= 0) {
+        available = qMin(available, limit);
+    }
+
+    if (!m_bandwidthLimiter) {
+        return available;
+    }
+
+    QString host = reply->url().host().toLower();
+
+    if (throttle) {
+        return m_bandwidthLimiter->request(reply, host, available);
+    }
+
+    m_bandwidthLimiter->consume(host, available);
+    return available;
+}
+
+qint64 PodcastEpisode::transferData(QNetworkReply *reply, qint64 position,
+    qint64 end, bool throttle)
+{
+    if (m_diskWriter) {
+        return queueData(reply, position, end, throttle);
+    }
+
+    qint64 remaining = getReadSize(reply, throttle);
+    if (remaining <= 0) {
+        return 0;
+    }
+
+    QByteArray fallbackBuffer;
+    char *buffer = m_bufferPool ? m_bufferPool->acquire() : 0;
+    qint64 bufferSize = m_bufferPool ? m_bufferPool->getBufferSize() : 0;
+    if (!buffer) {
+        fallbackBuffer.resize(fallbackBufferSize);
+        buffer = fallbackBuffer.data();
+        bufferSize = fallbackBuffer.size();
+    }
+
+    qint64 written = 0;
+    bool ok = true;
+
+    while (remaining > 0) {
+        qint64 count = reply->read(buffer, qMin(remaining, bufferSize));
+        if (count <= 0) {
+            break;
+        }
+        remaining -= count;
+
+        if (end >= 0) {
+            count = qBound(Q_INT64_C(0), end + 1 - position - written, count);
+        }
+        if (count > 0) {
+            hashData(position + written, buffer, count);
+            if (!writeAt(position + written, buffer, count)) {
+                ok = false;
+                break;
+            }
+        }
+        written += count;
+    }
+
+    if (fallbackBuffer.isEmpty()) {
+        m_bufferPool->release(buffer);
+    }
+
+    return ok ? written : -1;
+}
+
+qint64 PodcastEpisode::queueData(QNetworkReply *reply, qint64 position,
+    qint64 end, bool throttle)
+{
+    if (m_writeHandle == -1) {
+        m_writeHandle = m_diskWriter->open(getPartialSaveLocation());
+    }
+    if (m_diskWriter->hasFailed(m_writeHandle)) {
+        return -1;
+    }
+
+    qint64 bufferSize = m_bufferPool ? m_bufferPool->getBufferSize()
+        : fallbackBufferSize;
+
+    // Only read what there are free buffers for. The rest stays in the
+    // socket until the writer has caught up. The notification is requested
+    // before checking again so a write finishing in between is not missed.
+    qint64 limit = -1;
+    if (throttle && m_bufferPool) {
+        if (m_bufferPool->getAvailableCount() == 0) {
+            m_diskWriter->notifyWhenWritten();
+        }
+        limit = m_bufferPool->getAvailableCount() * bufferSize;
+        if (limit == 0) {
+            return 0;
+        }
+    }
+
+    qint64 remaining = getReadSize(reply, throttle, limit);
+    qint64 written = 0;
+    BufferPool *pool = 0;
+    char *buffer = 0;
+
+    while (remaining > 0) {
+        // The pool can run out while draining a finished reply.
+        if (!buffer) {
+            pool = m_bufferPool;
+            buffer = pool ? pool->acquire() : 0;
+            if (!buffer) {
+                pool = 0;
+                buffer = new char[bufferSize];
+            }
+        }
+
+        qint64 count = reply->read(buffer, qMin(remaining, bufferSize));
+        if (count <= 0) {
+            break;
+        }
+        remaining -= count;
+
+        if (end >= 0) {
+            count = qBound(Q_INT64_C(0), end + 1 - position - written, count);
+        }
+        if (count > 0) {
+            hashData(position + written, buffer, count);
+            // The writer owns the buffer from here on.
+            m_diskWriter->write(m_writeHandle, position + written, buffer,
+                count, pool);
+            buffer = 0;
+        }
+        written += count;
+    }
+
+    if (buffer && pool) {
+        pool->release(buffer);
+    }
+    else if (buffer) {
+        delete[] buffer;
+    }
+
+    return written;
+}
+
+bool PodcastEpisode::closeWriteHandle()
+{
+    if (!m_diskWriter || m_writeHandle == -1) {
+        return true;
+    }
+
+    m_diskWriter->waitForWrites(m_writeHandle);
+    bool written = !m_diskWriter->hasFailed(m_writeHandle);
+
+    // Wait for the close as well so the file can be renamed.
+    m_diskWriter->close(m_writeHandle);
+    m_diskWriter->waitForWrites(m_writeHandle);
+    m_writeHandle = -1;
+
+    return written;
+}
+
+bool PodcastEpisode::writeAt(qint64 position, const char *data, qint64 size)
+{
+    if (!m_file || !m_file->seek(position)) {
+        return false;
+    }
+    return m_file->write(data, size) == size;
+}
+
+void PodcastEpisode::hashData(qint64 position, const char *data,
+    qint64 size)
+{
+    if (m_hash && position == m_hashedPosition) {
+        m_hash->addData(data, size);
+        m_hashedPosition += size;
     }
 }
 
+void PodcastEpisode::resetHash()
+{
+    if (m_hash) {
+        m_hash->reset();
+    }
+    m_hashedPosition = 0;
+    m_contentHash.clear();
+    m_fileSize = -1;
+}
+
+void PodcastEpisode::finishHash()
+{
+    m_fileSize = m_file->size();
+
+    if (!m_hash) {
+        return;
+    }
+    if (m_hashedPosition > m_fileSize) {
+        resetHash();
+        m_fileSize = m_file->size();
+    }
+
+    // Data that did not arrive in order is read back from the file.
+    if (m_hashedPosition < m_fileSize) {
+        QByteArray buffer(fallbackBufferSize, 0);
+
+        if (!m_file->seek(m_hashedPosition)) {
+            return;
+        }
+        while (m_hashedPosition < m_fileSize) {
+            qint64 count = m_file->read(buffer.data(), buffer.size());
+            if (count <= 0) {
+                return;
+            }
+            m_hash->addData(buffer.constData(), count);
+            m_hashedPosition += count;
+        }
+    }
+
+    m_contentHash = m_hash->result();
+}
+
+EpisodeSegment *PodcastEpisode::findSegment(QObject *reply) const
+{
+    Q_FOREACH (EpisodeSegment *segment, m_segments) {
+        if (segment->getNetworkReply() == reply) {
+            return segment;
+        }
+    }
+    return 0;
+}
+
+bool PodcastEpisode::isSegmentsComplete() const
+{
+    if (m_segmentEnd >= 0 && m_writePosition <= m_segmentEnd) {
+        return false;
+    }
+
+    Q_FOREACH (EpisodeSegment *segment, m_segments) {
+        if (!segment->isComplete()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PodcastEpisode::clearSegments()
+{
+    if (m_segments.isEmpty()) {
+        return;
+    }
+
+    // Only the data up to the first gap can be resumed. The segments are
+    // kept in the order of their ranges.
+    qint64 resumable = m_writePosition;
+    if (m_writePosition > m_segmentEnd) {
+        Q_FOREACH (EpisodeSegment *segment, m_segments) {
+            if (segment->getStart() != resumable) {
+                break;
+            }
+            resumable = segment->getPosition();
+            if (!segment->isComplete()) {
+                break;
+            }
+        }
+    }
+
+    Q_FOREACH (EpisodeSegment *segment, m_segments) {
+        QNetworkReply *reply = segment->getNetworkReply();
+
+        disconnect(reply, SIGNAL(readyRead()), this,
+            SLOT(writeSegmentData()));
+        disconnect(reply, SIGNAL(finished()), this, SLOT(segmentFinished()));
+        reply->abort();
+        reply->deleteLater();
+
+        delete segment;
+    }
+    m_segments.clear();
+    m_segmentEnd = -1;
+
+    // Data that failed to be written leaves holes in the file.
+    if (!closeWriteHandle()) {
+        m_discardPartial = true;
+    }
+
+    if (m_file && m_file->size() > resumable) {
+        m_file->resize(resumable);
+    }
+}
+
+void PodcastEpisode::processHeaders()
+{
+    if (!m_reply || m_headersProcessed) {
+        return;
+    }
+
+    QVariant statusCode = m_reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute);
+    if (statusCode.isNull()) {
+        return;
+    }
+    m_headersProcessed = true;
+    m_writeEnabled = false;
+
+    // Whichever request responded first is the one being processed.
+    m_responseDelay = m_requestTime.elapsed();
+    clearHedge();
+
+    switch (statusCode.toInt()) {
+        // OK
+        // The server sent the whole file. Either no range was requested or
+        // the file changed since the partial download. Start over.
+        case 200:
+            resetWrite();
+            m_writePosition = 0;
+            m_writeEnabled = true;
+
+            if (!m_reply->header(QNetworkRequest::ContentLengthHeader)
+                .isNull())
+            {
+                m_contentLength = m_reply->header(
+                    QNetworkRequest::ContentLengthHeader).toLongLong();
+            }
+            m_acceptRanges = m_reply->rawHeader("Accept-Ranges").trimmed()
+                .toLower() == "bytes";
+            break;
+        // Partial Content
+        case 206: {
+            // Content-Range: bytes START-END/TOTAL
+            QByteArray range = m_reply->rawHeader("Content-Range");
+            int dash = range.indexOf('-');
+            qint64 start = -1;
+
+            if (range.startsWith("bytes ") && dash > 6) {
+                bool ok = false;
+                start = range.mid(6, dash - 6).trimmed().toLongLong(&ok);
+                if (!ok) {
+                    start = -1;
+                }
+            }
+
+            // Writing past the end of the partial file would leave a hole.
+            closeWriteHandle();
+            if (start != m_hashedPosition) {
+                resetHash();
+            }
+            if (!m_file || start < 0 || start > m_file->size()) {
+                m_discardPartial = true;
+                setFailure(TransientFailure);
+                cleanDownload();
+                emit error(this, tr("Server resumed the download at an"
+                    " unexpected position."));
+                return;
+            }
+
+            m_file->resize(start);
+            m_writePosition = start;
+            m_writeEnabled = true;
+            break;
+        }
+        // Requested Range Not Satisfiable
+        case 416: {
+            // Content-Range: bytes */TOTAL
+            QByteArray range = m_reply->rawHeader("Content-Range").trimmed();
+            qint64 total = -1;
+
+            if (range.startsWith("bytes */")) {
+                bool ok = false;
+                total = range.mid(8).trimmed().toLongLong(&ok);
+                if (!ok) {
+                    total = -1;
+                }
+            }
+
+            // The partial file already holds the whole episode. Nothing is
+            // left to download.
+            if (m_file && total > 0 && total == m_file->size()) {
+                disconnect(m_reply, SIGNAL(finished()), this,
+                    SLOT(downloadFinished()));
+                completeDownload();
+                return;
+            }
+
+            // The partial file does not match what the server has. It
+            // cannot be resumed so it will be started over on the next
+            // attempt.
+            m_discardPartial = true;
+            return;
+        }
+        default:
+            return;
+    }
+
+    // Weak ETags cannot be used with If-Range.
+    QByteArray eTag = m_reply->rawHeader("ETag");
+    if (!eTag.isEmpty() && !eTag.startsWith("W/")) {
+        m_validator = QString::fromAscii(eTag);
+        m_contentETag = m_validator;
+    }
+    else {
+        m_validator = QString::fromAscii(m_reply->rawHeader("Last-Modified"));
+        m_contentETag.clear();
+    }
+
+    emit headersReceived(this);
+}
+
 bool PodcastEpisode::greaterThan(PodcastEpisode *ep1, PodcastEpisode *ep2)
 {
-    if (ep1->getPublishDate() > ep2->getPublishDate()) {
+    // Episodes without a date sort last.
+    if (ep1->getPublishTime() > ep2->getPublishTime()) {
         return true;
     }
     return false;
@@ -127,19 +1050,92 @@ bool PodcastEpisode::greaterThan(PodcastEpisode *ep1, PodcastEpisode *ep2)
 
 bool PodcastEpisode::downloadSuccessful()
 {
+    // Anything held back by the bandwidth limiter still needs to be written.
+    if (m_writeEnabled) {
+        writeReplyData(false);
+        if (!m_file) {
+            return false;
+        }
+    }
+
+    if (!isSegmentsComplete()) {
+        setFailure(TransientFailure);
+        emit error(this, tr("Download of %1 ended before all segments were"
+            " complete.").arg(getName()));
+        return false;
+    }
+
+    // Everything queued for the disk writer has to be on disk before the
+    // file is moved into place.
+    if (!closeWriteHandle()) {
+        m_discardPartial = true;
+        setFailure(TransientFailure);
+        emit error(this, tr("Could not write to file %1.")
+            .arg(getPartialSaveLocation()));
+        return false;
+    }
+    clearSegments();
+
     if (m_file) {
+        finishHash();
         m_file->close();
         delete m_file;
         m_file = 0;
     }
 
+    // The partial file is moved into place by publish.
     return true;
 }
 
+bool PodcastEpisode::publish()
+{
+    // A linked episode is already in place.
+    if (!m_linkedFrom.isEmpty()) {
+        return true;
+    }
+
+    // Replace any existing file in one step so the save location never
+    // holds a partial file.
+    if (Platform::replaceFile(getPartialSaveLocation(), m_fileName)) {
+        return true;
+    }
+
+    if (QFile::exists(m_fileName)) {
+        QFile::remove(m_fileName);
+    }
+    return QFile::rename(getPartialSaveLocation(), m_fileName);
+}
+
+bool PodcastEpisode::isThrottled() const
+{
+    if (!m_bandwidthLimiter || !m_bandwidthLimiter->isLimited()) {
+        return false;
+    }
+
+    if (m_reply && m_reply->bytesAvailable() > 0) {
+        return true;
+    }
+    Q_FOREACH (EpisodeSegment *segment, m_segments) {
+        if (segment->getNetworkReply()->bytesAvailable() > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void PodcastEpisode::cleanDownload()
 {
+    clearHedge();
+    clearSegments();
+    if (!closeWriteHandle()) {
+        m_discardPartial = true;
+    }
+
     if (m_reply) {
         disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(writeData()));
+        disconnect(m_reply, SIGNAL(metaDataChanged()), this,
+            SLOT(processHeaders()));
         disconnect(m_reply, SIGNAL(finished()), this,
             SLOT(downloadFinished()));
 
@@ -148,12 +1144,14 @@ void PodcastEpisode::cleanDownload()
         m_reply = 0;
     }
 
-    // If the download was successful the file will have been closed already
-    // so deleting the file here won't delete it if it was a successful
-    // download.
+    // If the download was successful the file will have been closed and
+    // renamed already. Otherwise the partial file is kept so the download
+    // can be resumed unless it has been marked as unusable.
     if (m_file) {
         m_file->close();
-        m_file->remove();
+        if (m_discardPartial) {
+            m_file->remove();
+        }
         delete m_file;
         m_file = 0;
     }
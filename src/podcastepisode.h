@@ -21,10 +21,18 @@
 #ifndef PODCASTEPISODE_H
 #define PODCASTEPISODE_H
 
-#include <QDateTime>
 #include <QFile>
+#include <QList>
+#include <QNetworkRequest>
+#include <QTime>
+#include <QTimer>
 
+#include "bandwidthlimiter.h"
+#include "bufferpool.h"
+#include "contenthash.h"
+#include "diskwriter.h"
 #include "downloaditem.h"
+#include "episodesegment.h"
 
 /**
  * A representation of a podcast episode.
@@ -38,17 +46,156 @@ class PodcastEpisode : public DownloadItem
         ~PodcastEpisode();
 
         /**
-         * Get's the date the episode was published.
+         * Get's the time the episode was published.
          *
-         * @return The publish date.
+         * @return The time in seconds since 1970-01-01 00:00:00 UTC. -1 if
+         * the feed did not list a date that could be parsed.
          */
-        QDateTime getPublishDate() const;
+        qint64 getPublishTime() const;
+        /**
+         * Get's the size of the episode listed in the rss feed.
+         *
+         * @return The length attribute of the enclosure in bytes. -1 if the
+         * feed did not list it.
+         */
+        qint64 getEnclosureLength() const;
         /**
          * Get's the location where the episode will be downloaded to.
          *
          * @return The save location.
          */
          QString getSaveLocation() const;
+        /**
+         * Get's the temporary file the episode is written to while it is
+         * downloading.
+         *
+         * The partial file is kept when a download fails so the download can
+         * be resumed later. It is renamed to the save location once the
+         * download completes.
+         *
+         * @return The partial file name including path.
+         */
+        QString getPartialSaveLocation() const;
+        /**
+         * Get's the url of the podcast the episode belongs to.
+         *
+         * @return The podcast url.
+         */
+        QUrl getPodcastUrl() const;
+        /**
+         * Get's the unique identifier of the episode listed in the rss feed.
+         *
+         * @return The guid. An empty string if the feed did not list one.
+         */
+        QString getGuid() const;
+        /**
+         * Gets the number of bytes already on disk from a previous attempt
+         * at downloading the episode.
+         *
+         * @return The offset to resume the download from. 0 if there is no
+         * partial download.
+         */
+        qint64 getResumeOffset() const;
+        /**
+         * Gets the validator the server reported for the episode.
+         *
+         * The validator is the ETag if the server sent a strong one.
+         * Otherwise it is the Last-Modified date. It is used with the
+         * If-Range header to make sure a resumed download is not stitched
+         * together from two different versions of the file.
+         *
+         * @return The validator. An empty string if the server did not send
+         * one.
+         */
+        QString getValidator() const;
+        /**
+         * Gets the size of the episode reported by the server.
+         *
+         * @return The content length. -1 if the server did not report it.
+         */
+        qint64 getContentLength() const;
+        /**
+         * Gets the url the episode is currently being downloaded from.
+         *
+         * This is the url after any redirects.
+         *
+         * @return The download url.
+         */
+        QUrl getDownloadUrl() const;
+        /**
+         * Can the episode be split into segments that are downloaded in
+         * parallel.
+         *
+         * The server must have sent the whole file with its size, advertised
+         * byte range support and sent a validator.
+         *
+         * @return True if the download can be split.
+         */
+        bool isRangeSupported() const;
+        /**
+         * Gets the number of additional connections used to download
+         * segments of the episode.
+         *
+         * @return The number of segments started for the current download.
+         */
+        int getSegmentCount() const;
+        /**
+         * Gets the hash of the downloaded episode.
+         *
+         * The hash is computed as the data arrives. Only data that did not
+         * arrive in order, such as resumed or segmented downloads, is read
+         * back from disk when the download completes.
+         *
+         * @return The hash as lower case hex. An empty string until the
+         * download has completed or if hashing is disabled.
+         */
+        QString getContentHash() const;
+        /**
+         * Gets the name of the algorithm the content hash was computed with.
+         *
+         * @return The algorithm name. An empty string if hashing is
+         * disabled.
+         */
+        QString getHashAlgorithm() const;
+        /**
+         * Gets the size of the downloaded episode on disk.
+         *
+         * @return The size in bytes. -1 until the download has completed.
+         */
+        qint64 getFileSize() const;
+        /**
+         * Gets the strong ETag the server sent with the episode.
+         *
+         * @return The ETag. An empty string if the server did not send one
+         * or it was weak.
+         */
+        QString getContentETag() const;
+        /**
+         * Gets the file the episode was linked to instead of being
+         * downloaded.
+         *
+         * @return The file name including path. An empty string if the
+         * episode was downloaded.
+         *
+         * @see linkExisting
+         */
+        QString getLinkedFrom() const;
+        /**
+         * Gets the request the current download was started with.
+         *
+         * @return The request. An empty request if nothing is downloading.
+         */
+        QNetworkRequest getRequest() const;
+        /**
+         * Gets how long the server took to respond to the current download.
+         *
+         * This is measured from when the download was started, so a second
+         * request that responded first is counted from the first request.
+         *
+         * @return The time in milliseconds. -1 until the server has
+         * responded.
+         */
+        int getResponseDelay() const;
         /**
          * Does this episode contain explicit content.
          *
@@ -62,17 +209,72 @@ class PodcastEpisode : public DownloadItem
         bool isExplicit();
 
         /**
-         * Set the date the episode was published.
+         * Set the time the episode was published.
+         *
+         * @param time The time in seconds since 1970-01-01 00:00:00 UTC. -1
+         * if it is not known.
+         */
+        void setPublishTime(qint64 time);
+        /**
+         * Set the size of the episode listed in the rss feed.
          *
-         * @param date The published date.
+         * @param length The length in bytes. -1 if it is not known.
          */
-        void setPublishDate(const QDateTime &date);
+        void setEnclosureLength(qint64 length);
         /**
          * Set where the episode should be saved on disk to.
          *
          * @param fileName The name of the file including path to save to.
          */
         void setSaveLocation(const QString &fileName);
+        /**
+         * Set the url of the podcast the episode belongs to.
+         *
+         * @param url The podcast url.
+         */
+        void setPodcastUrl(const QUrl &url);
+        /**
+         * Set the unique identifier of the episode listed in the rss feed.
+         *
+         * @param guid The guid.
+         */
+        void setGuid(const QString &guid);
+        /**
+         * Sets the bandwidth limiter used to throttle reading the download.
+         *
+         * @param limiter The limiter. 0 to not limit the download.
+         */
+        void setBandwidthLimiter(BandwidthLimiter *limiter);
+        /**
+         * Sets the pool of buffers data is read into.
+         *
+         * @param pool The pool. 0 to use a buffer of the episode's own.
+         */
+        void setBufferPool(BufferPool *pool);
+        /**
+         * Sets the thread that writes the data to disk.
+         *
+         * @param writer The writer. 0 to write from the main thread.
+         */
+        void setDiskWriter(DiskWriter *writer);
+        /**
+         * Sets the algorithm the content is hashed with.
+         *
+         * @param algorithm The algorithm. ContentHash::NoHash to not hash
+         * the content.
+         */
+        void setHashAlgorithm(ContentHash::Algorithm algorithm);
+        /**
+         * Sets how long a download waits for the server to respond before
+         * hedgeRequested is emitted.
+         *
+         * Applies to downloads started after it is set.
+         *
+         * @param delay The delay in milliseconds. 0 to never emit it.
+         *
+         * @see setHedgeReply
+         */
+        void setHedgeDelay(int delay);
         /**
          * Sets the explicit status of the episode.
          *
@@ -81,12 +283,70 @@ class PodcastEpisode : public DownloadItem
         void setExplicit(bool isExplicit);
 
         /**
-         * Set the write to take place at the beginning of the file.
+         * Discard any partially downloaded data so the download starts at the
+         * beginning of the file.
          *
-         * This is for use when the content has moved and the download is
-         * restarted.
+         * This is for use when a partial download cannot be resumed.
          */
         void resetWrite();
+        /**
+         * Stop the current download once it reaches the given byte.
+         *
+         * Used when the rest of the episode is downloaded in segments.
+         *
+         * @param end The last byte to write from the current download.
+         *
+         * @see addSegment
+         */
+        void setSegmentEnd(qint64 end);
+        /**
+         * Stop the download and hard link an identical file that is already
+         * on disk to the save location instead.
+         *
+         * The partial file is removed. Nothing is emitted.
+         *
+         * @param path The file name including path of the identical file.
+         *
+         * @return True if the file was linked. False if linking is not
+         * possible, in which case the download continues.
+         */
+        bool linkExisting(const QString &path);
+        /**
+         * Move the completed partial file to the save location.
+         *
+         * Called once the download has finished and the partial file has
+         * been synced to disk as the durability policy requires.
+         *
+         * @return True if the episode is at its save location.
+         */
+        bool publish();
+        /**
+         * Download a range of the episode over an additional connection.
+         *
+         * The episode takes ownership of the reply.
+         *
+         * @param reply The network reply downloading the range.
+         * @param start The first byte of the range.
+         * @param end The last byte of the range.
+         *
+         * @see setSegmentEnd
+         */
+        void addSegment(QNetworkReply *reply, qint64 start, qint64 end);
+        /**
+         * Race the current download with a second request for the same
+         * data.
+         *
+         * Whichever reply responds first is used and the other is aborted.
+         * hedgeResolved is emitted once that is decided. If the second
+         * request fails before responding the current download carries on.
+         *
+         * The episode takes ownership of the reply.
+         *
+         * @param reply The network reply of the second request.
+         *
+         * @see hedgeRequested
+         */
+        void setHedgeReply(QNetworkReply *reply);
 
         void setNetworkReply(QNetworkReply *reply);
 
@@ -107,24 +367,372 @@ class PodcastEpisode : public DownloadItem
          */
         void writeData();
 
+    signals:
+        /**
+         * This signal is emitted when the server has responded with the
+         * content of the episode and the data is about to be written.
+         *
+         * @param item this.
+         */
+        void headersReceived(DownloadItem *item);
+        /**
+         * This signal is emitted when the server has not responded within
+         * the hedge delay.
+         *
+         * @param item this.
+         *
+         * @see setHedgeDelay
+         */
+        void hedgeRequested(DownloadItem *item);
+        /**
+         * This signal is emitted when the second request set with
+         * setHedgeReply is no longer running.
+         *
+         * @param item this.
+         * @param hedgeWon True if the second request responded first and is
+         * now the current download. False if it was aborted or failed.
+         */
+        void hedgeResolved(DownloadItem *item, bool hedgeWon);
+
+    private slots:
+        /**
+         * Check the response headers to determine where the data should be
+         * written.
+         *
+         * A 206 partial content response continues the partial file. A 200
+         * response starts the partial file over. Any other response does not
+         * contain episode data and is not written.
+         */
+        void processHeaders();
+        /**
+         * Write the data downloaded by a segment to disk.
+         */
+        void writeSegmentData();
+        /**
+         * Write data that was held back by the bandwidth limiter.
+         */
+        void readPendingData();
+        /**
+         * A segment's network reply has finished.
+         *
+         * Completes the download if this was the last outstanding part of
+         * the episode.
+         */
+        void segmentFinished();
+        /**
+         * The hedge delay has passed. Asks for a second request if the
+         * server has still not responded.
+         */
+        void requestHedge();
+        /**
+         * The second request has received its response headers.
+         */
+        void hedgeResponded();
+        /**
+         * The second request has finished.
+         *
+         * It either failed before responding or finished before its headers
+         * were seen.
+         */
+        void hedgeFinished();
+
     protected:
         bool downloadSuccessful();
         void cleanDownload();
+        bool isThrottled() const;
 
     private:
         /**
-         * When the episode was published.
+         * Make a reply the current download and connect its signals.
+         *
+         * The previous reply is deleted.
+         *
+         * @param reply The network reply.
+         */
+        void installReply(QNetworkReply *reply);
+        /**
+         * Replace the current download with the second request.
+         *
+         * The first request is aborted.
+         */
+        void useHedgeReply();
+        /**
+         * Abort the second request if there is one.
          */
-        QDateTime m_publishDate;
+        void clearHedge();
+        /**
+         * Write the data available from the current reply to disk.
+         *
+         * @param throttle True if the bandwidth limiter should decide how
+         * much is read. False to read everything available.
+         *
+         * @return True if the reply reached the end of its segment and was
+         * stopped.
+         */
+        bool writeReplyData(bool throttle);
+        /**
+         * Write the data available from a segment to disk.
+         *
+         * @param segment The segment.
+         * @param throttle True if the bandwidth limiter should decide how
+         * much is read. False to read everything available.
+         */
+        void writeSegment(EpisodeSegment *segment, bool throttle);
+        /**
+         * Gets how much data can be read from a reply.
+         *
+         * @param reply The reply to read from.
+         * @param throttle True if the bandwidth limiter should decide how
+         * much is read. False to read everything available.
+         * @param limit The most that should be read. -1 for no limit.
+         *
+         * @return The number of bytes to read.
+         */
+        qint64 getReadSize(QNetworkReply *reply, bool throttle,
+            qint64 limit=-1);
+        /**
+         * Read data from a reply and write it to the file.
+         *
+         * The data is read through a buffer from the buffer pool. If there
+         * is a disk writer the data is queued for it instead of being
+         * written directly.
+         *
+         * @param reply The reply to read from.
+         * @param position Where to write the first byte.
+         * @param end The last byte that belongs to the reply. Anything past
+         * it is read and thrown away. -1 for no limit.
+         * @param throttle True if the bandwidth limiter should decide how
+         * much is read. False to read everything available.
+         *
+         * @return The number of bytes written. -1 if writing failed.
+         */
+        qint64 transferData(QNetworkReply *reply, qint64 position, qint64 end,
+            bool throttle);
+        /**
+         * Read data from a reply and queue it for the disk writer.
+         *
+         * Each buffer read into is handed to the writer. When throttled only
+         * as much is read as there are free buffers in the pool.
+         *
+         * @param reply The reply to read from.
+         * @param position Where to write the first byte.
+         * @param end The last byte that belongs to the reply. -1 for no
+         * limit.
+         * @param throttle True if the bandwidth limiter and the free buffers
+         * should decide how much is read. False to read everything
+         * available.
+         *
+         * @return The number of bytes queued. -1 if an earlier write failed.
+         */
+        qint64 queueData(QNetworkReply *reply, qint64 position, qint64 end,
+            bool throttle);
+        /**
+         * Wait for everything queued for the disk writer to be written and
+         * close the writer's file.
+         *
+         * Must be called before the file is changed from the main thread.
+         *
+         * @return True if all of the queued data was written.
+         */
+        bool closeWriteHandle();
+        /**
+         * Write data to the file at the given position.
+         *
+         * @param position Where to write the data.
+         * @param data The data to write.
+         * @param size The number of bytes to write.
+         *
+         * @return True if all of the data was written.
+         */
+        bool writeAt(qint64 position, const char *data, qint64 size);
+        /**
+         * Add data to the content hash if it continues the data hashed so
+         * far.
+         *
+         * @param position Where the data is written in the file.
+         * @param data The data.
+         * @param size The number of bytes.
+         */
+        void hashData(qint64 position, const char *data, qint64 size);
+        /**
+         * Start the content hash over from the beginning of the file.
+         */
+        void resetHash();
+        /**
+         * Hash the rest of the completed file and record its size.
+         *
+         * Data that was not hashed as it arrived is read from the file.
+         */
+        void finishHash();
+        /**
+         * Gets the segment that is downloading with the given reply.
+         *
+         * @param reply The network reply.
+         *
+         * @return The segment. 0 if the reply does not belong to a segment.
+         */
+        EpisodeSegment *findSegment(QObject *reply) const;
+        /**
+         * Has every part of a segmented download been written.
+         *
+         * @return True if the download is complete.
+         */
+        bool isSegmentsComplete() const;
+        /**
+         * Abort and remove all segments.
+         *
+         * The partial file is truncated to the data that was downloaded
+         * without gaps so it can be resumed.
+         */
+        void clearSegments();
+
+        /**
+         * When the episode was published in seconds since 1970 UTC.
+         */
+        qint64 m_publishTime;
+        /**
+         * The size of the episode listed in the rss feed.
+         */
+        qint64 m_enclosureLength;
 
         /**
          * The file name with path to save to.
          */
         QString m_fileName;
+        /**
+         * The url of the podcast the episode belongs to.
+         */
+        QUrl m_podcastUrl;
+        /**
+         * The unique identifier listed in the rss feed.
+         */
+        QString m_guid;
         /**
          * The file object to use for writing.
          */
         QFile *m_file;
+        /**
+         * Throttles reading the download. Not owned by the episode.
+         */
+        BandwidthLimiter *m_bandwidthLimiter;
+        /**
+         * Buffers data is read into. Not owned by the episode.
+         */
+        BufferPool *m_bufferPool;
+        /**
+         * Writes the data to disk. Not owned by the episode.
+         */
+        DiskWriter *m_diskWriter;
+        /**
+         * The disk writer's handle for the partial file. -1 when it is not
+         * open.
+         */
+        int m_writeHandle;
+        /**
+         * Hashes the content as it is written. 0 when hashing is disabled.
+         */
+        ContentHash *m_hash;
+        /**
+         * The number of bytes from the start of the file that have been
+         * added to m_hash.
+         */
+        qint64 m_hashedPosition;
+        /**
+         * The hash of the completed download.
+         */
+        QString m_contentHash;
+        /**
+         * The size of the completed download.
+         */
+        qint64 m_fileSize;
+        /**
+         * The strong ETag reported by the server.
+         */
+        QString m_contentETag;
+        /**
+         * The identical file the episode was linked to.
+         */
+        QString m_linkedFrom;
+        /**
+         * The ETag or Last-Modified date reported by the server.
+         */
+        QString m_validator;
+        /**
+         * The content length reported by the server.
+         */
+        qint64 m_contentLength;
+        /**
+         * Whether the server advertised byte range support.
+         */
+        bool m_acceptRanges;
+        /**
+         * Where the next data from the current reply is written.
+         */
+        qint64 m_writePosition;
+        /**
+         * The last byte to write from the current reply. -1 when the
+         * download is not segmented.
+         */
+        qint64 m_segmentEnd;
+        /**
+         * The segments downloading the rest of the episode.
+         */
+        QList<EpisodeSegment *> m_segments;
+        /**
+         * The second request racing the current download. 0 if there is
+         * none.
+         */
+        QNetworkReply *m_hedgeReply;
+        /**
+         * Fires requestHedge once the hedge delay has passed.
+         */
+        QTimer m_hedgeTimer;
+        /**
+         * Milliseconds to wait for a response before asking for a second
+         * request. 0 to never ask.
+         */
+        int m_hedgeDelay;
+        /**
+         * When the current download was started.
+         */
+        QTime m_requestTime;
+        /**
+         * Milliseconds the server took to respond. -1 until it has.
+         */
+        int m_responseDelay;
+        /**
+         * The number of segments started for the current download.
+         */
+        int m_segmentCount;
+        /**
+         * Whether processHeaders has run for the current reply.
+         */
+        bool m_headersProcessed;
+        /**
+         * Whether the data in the current reply should be written to the
+         * file.
+         */
+        bool m_writeEnabled;
+        /**
+         * Remove the partial file when the download is cleaned up instead of
+         * keeping it to resume from.
+         */
+        bool m_discardPartial;
+
+        /**
+         * The read buffer size of replies. Once the buffer is full the
+         * server is slowed down by TCP instead of the data building up in
+         * memory.
+         */
+        static const qint64 readBufferSize;
+        /**
+         * The read buffer size of replies when the bandwidth is limited.
+         */
+        static const qint64 throttledReadBufferSize;
+        /**
+         * The size of the buffer used when there is no buffer pool.
+         */
+        static const int fallbackBufferSize;
         /**
          * The explicit status of the episode. Episodes default to not
          * explicit.
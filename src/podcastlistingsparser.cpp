@@ -57,6 +57,13 @@ void PodcastListingsParser::parseListingsFile(const QString &listingsFile)
         return;
     }
 
+    ElementTable elements;
+    elements.insert("name", NameElement);
+    elements.insert("init", InitElement);
+    elements.insert("ignore_not_modified", IgnoreNotModifiedElement);
+    elements.insert("category", CategoryElement);
+    elements.insert("url", UrlElement);
+
     QDomElement itemElement = rootElement.firstChildElement("item");
 
     while (!itemElement.isNull()) {
@@ -65,22 +72,24 @@ void PodcastListingsParser::parseListingsFile(const QString &listingsFile)
         Podcast *podcast = new Podcast();
 
         while (!dataElement.isNull()) {
-            if (dataElement.tagName().trimmed().toLower() == "name") {
-                podcast->setName(dataElement.text());
-            }
-            else if (dataElement.tagName().trimmed().toLower() == "init") {
-                podcast->setInit(true);
-            }
-            else if (dataElement.tagName().trimmed().toLower()
-            	== "ignore_not_modified")
-            {
-            	podcast->setIgnoreNotModified(true);
-            }
-            else if (dataElement.tagName().trimmed().toLower() == "category") {
-                podcast->setCategory(dataElement.text());
-            }
-            else if (dataElement.tagName().trimmed().toLower() == "url") {
-                podcast->setUrl(QUrl(dataElement.text()));
+            switch (elements.find(dataElement.tagName())) {
+                case NameElement:
+                    podcast->setName(dataElement.text());
+                    break;
+                case InitElement:
+                    podcast->setInit(true);
+                    break;
+                case IgnoreNotModifiedElement:
+                    podcast->setIgnoreNotModified(true);
+                    break;
+                case CategoryElement:
+                    podcast->setCategory(dataElement.text());
+                    break;
+                case UrlElement:
+                    podcast->setUrl(QUrl(dataElement.text()));
+                    break;
+                default:
+                    break;
             }
 
             dataElement = dataElement.nextSiblingElement();
@@ -23,6 +23,7 @@
 
 #include <QObject>
 
+#include "elementtable.h"
 #include "podcast.h"
 
 /**
@@ -66,6 +67,17 @@ class PodcastListingsParser : public QObject
         void error(const QString &error, bool fatal);
 
     private:
+        /**
+         * The elements of an item in the listings file.
+         */
+        enum Element {
+            NameElement,
+            InitElement,
+            IgnoreNotModifiedElement,
+            CategoryElement,
+            UrlElement
+        };
+
         /**
          * The list of podcasts.
          */
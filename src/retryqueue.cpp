@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "retryqueue.h"
+
+RetryQueue::RetryQueue()
+{
+    m_clock.start();
+    m_timer.setSingleShot(true);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(checkWaiting()));
+}
+
+void RetryQueue::schedule(DownloadItem *item, int delay)
+{
+    remove(item);
+    m_waiting.insertMulti(m_clock.elapsed() + qMax(delay, 0), item);
+    updateTimer();
+}
+
+void RetryQueue::remove(DownloadItem *item)
+{
+    m_ready.removeAll(item);
+
+    QMap<int, DownloadItem *>::iterator i = m_waiting.begin();
+    while (i != m_waiting.end()) {
+        if (i.value() == item) {
+            i = m_waiting.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+    updateTimer();
+}
+
+bool RetryQueue::isEmpty() const
+{
+    return m_waiting.isEmpty() && m_ready.isEmpty();
+}
+
+QList<DownloadItem *> RetryQueue::getReadyItems() const
+{
+    return m_ready;
+}
+
+QList<DownloadItem *> RetryQueue::takeAll()
+{
+    QList<DownloadItem *> items = m_ready + m_waiting.values();
+
+    m_ready.clear();
+    m_waiting.clear();
+    m_timer.stop();
+
+    return items;
+}
+
+void RetryQueue::checkWaiting()
+{
+    int now = m_clock.elapsed();
+    bool moved = false;
+
+    // The map is ordered by due time so stop at the first item that is not
+    // due yet.
+    QMap<int, DownloadItem *>::iterator i = m_waiting.begin();
+    while (i != m_waiting.end() && i.key() <= now) {
+        m_ready.append(i.value());
+        i = m_waiting.erase(i);
+        moved = true;
+    }
+    updateTimer();
+
+    if (moved) {
+        emit ready();
+    }
+}
+
+void RetryQueue::updateTimer()
+{
+    if (m_waiting.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+
+    m_timer.start(qMax(m_waiting.begin().key() - m_clock.elapsed(), 0));
+}
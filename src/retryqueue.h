@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef RETRYQUEUE_H
+#define RETRYQUEUE_H
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QTime>
+#include <QTimer>
+
+#include "downloaditem.h"
+
+/**
+ * Holds failed downloads until they should be tried again.
+ *
+ * Items are scheduled with a delay. Once the delay has passed the item is
+ * moved to the ready list and the ready signal is emitted. The queue does not
+ * start downloads itself.
+ */
+class RetryQueue : public QObject
+{
+    Q_OBJECT
+
+    public:
+        RetryQueue();
+
+        /**
+         * Schedule an item to be tried again.
+         *
+         * @param item The item that failed.
+         * @param delay The number of milliseconds to wait.
+         */
+        void schedule(DownloadItem *item, int delay);
+        /**
+         * Removes an item from the queue without trying it again.
+         *
+         * @param item The item to remove.
+         */
+        void remove(DownloadItem *item);
+        /**
+         * Are there any waiting or ready items.
+         *
+         * @return True if the queue is empty.
+         */
+        bool isEmpty() const;
+        /**
+         * Gets the items whose delay has passed.
+         *
+         * Items stay in the queue until they are removed.
+         *
+         * @return The items that are ready to be tried again in the order
+         * they became ready.
+         */
+        QList<DownloadItem *> getReadyItems() const;
+        /**
+         * Removes every item from the queue.
+         *
+         * @return The waiting and ready items.
+         */
+        QList<DownloadItem *> takeAll();
+
+    signals:
+        /**
+         * This signal is emitted when one or more items are ready to be
+         * tried again.
+         */
+        void ready();
+
+    private slots:
+        /**
+         * Move the items whose delay has passed to the ready list.
+         */
+        void checkWaiting();
+
+    private:
+        /**
+         * Start the timer for the next waiting item.
+         */
+        void updateTimer();
+
+        /**
+         * The time since the queue was created. Used as the clock for the due
+         * times.
+         */
+        QTime m_clock;
+        /**
+         * The waiting items keyed by when they are due in milliseconds from
+         * the start of m_clock.
+         */
+        QMap<int, DownloadItem *> m_waiting;
+        /**
+         * The items that are ready to be tried again.
+         */
+        QList<DownloadItem *> m_ready;
+        /**
+         * Fires when the next waiting item is due.
+         */
+        QTimer m_timer;
+};
+
+#endif /* RETRYQUEUE_H */
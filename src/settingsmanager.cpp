@@ -61,8 +61,79 @@ SettingsManager::SettingsManager()
     // Whether explict episodes should be filtered.
     m_filterExplicit = value("advanced/filter_explicit", false).toBool();
 
+    // Start episodes while rss feeds are still being downloaded.
+    setEpisodeThreadShare(value("advanced/episode_thread_share", 0).toInt());
+
+    // Which episodes are downloaded first.
+    m_episodeOrder = value("advanced/episode_order", "round_robin")
+        .toString();
+
+    // Which backend the disk writer thread uses.
+    m_writeBackend = value("advanced/write_backend", "buffered").toString();
+
+    // How downloaded episodes are hashed.
+    m_hashAlgorithm = value("advanced/hash_algorithm", "sha256").toString();
+
+    // Whether identical episodes are stored once.
+    m_deduplicate = value("advanced/deduplicate", true).toBool();
+    m_deduplicatePrecheck = value("advanced/deduplicate_precheck", false)
+        .toBool();
+
+    // How completed episodes are made durable.
+    m_syncPolicy = value("advanced/sync_policy", "file").toString();
+    setSyncBatchSize(value("advanced/sync_batch_size", 10).toInt());
+
+    // Large feeds are only read as far as the episodes that are new.
+    setStopAfterKnown(value("advanced/stop_after_known", 0).toInt());
+
     // Whether the servers not modified response should be ignored.
     m_ignoreNotModified = value("network/ignore_not_modified", false).toBool();
+
+    // How many parallel connections a single episode can be downloaded with.
+    m_segmentCount = value("network/segment_count", 1).toInt();
+    if (m_segmentCount < 1) {
+        m_segmentCount = 1;
+    }
+
+    // Smaller episodes are not worth splitting into segments.
+    m_segmentMinimumSize = value("network/segment_minimum_size", 10240)
+        .toLongLong();
+    if (m_segmentMinimumSize < 0) {
+        m_segmentMinimumSize = 0;
+    }
+
+    // Keep from flooding a single host when many podcasts share it.
+    m_hostConnectionLimit = value("network/host_connection_limit", 0).toInt();
+    if (m_hostConnectionLimit < 0) {
+        m_hostConnectionLimit = 0;
+    }
+
+    // How fast episodes can be downloaded.
+    m_bandwidthLimit = qMax(value("network/bandwidth_limit", 0).toLongLong(),
+        Q_INT64_C(0));
+    m_hostBandwidthLimit = qMax(value("network/host_bandwidth_limit", 0)
+        .toLongLong(), Q_INT64_C(0));
+
+    // When the bandwidth limits apply.
+    setBandwidthLimitWindow(value("network/bandwidth_limit_window", "")
+        .toString());
+
+    // How failed downloads are tried again.
+    setRetryCount(value("network/retry_count", 3).toInt());
+    setRetryDelay(value("network/retry_delay", 5).toInt());
+    setRetryMaximumDelay(value("network/retry_max_delay", 300).toInt());
+
+    // Stalled and slow downloads are stopped so their thread can be used.
+    setConnectTimeout(value("network/connect_timeout", 30).toInt());
+    setFirstByteTimeout(value("network/first_byte_timeout", 60).toInt());
+    setIdleTimeout(value("network/idle_timeout", 60).toInt());
+    setMinimumRate(value("network/minimum_rate", 0).toInt());
+    setMinimumRateWindow(value("network/minimum_rate_window", 60).toInt());
+
+    // Slow responses are raced with a second request.
+    setHedgePercentile(value("network/hedge_percentile", 0).toInt());
+    setHedgeDelay(value("network/hedge_delay", 2000).toInt());
+    setHedgeOriginalUrl(value("network/hedge_original_url", 0).toBool());
 }
 
 void SettingsManager::writeDefaultConfig()
@@ -79,7 +150,33 @@ void SettingsManager::writeDefaultConfig()
     setValue("advanced/recent_episode_count", 0);
     setValue("advanced/minimum_free_space", 0);
     setValue("advanced/filter_explicit", 0);
+    setValue("advanced/episode_thread_share", 0);
+    setValue("advanced/episode_order", "round_robin");
+    setValue("advanced/write_backend", "buffered");
+    setValue("advanced/hash_algorithm", "sha256");
+    setValue("advanced/deduplicate", 1);
+    setValue("advanced/deduplicate_precheck", 0);
+    setValue("advanced/sync_policy", "file");
+    setValue("advanced/sync_batch_size", 10);
+    setValue("advanced/stop_after_known", 0);
     setValue("network/ignore_not_modified", 0);
+    setValue("network/segment_count", 1);
+    setValue("network/segment_minimum_size", 10240);
+    setValue("network/host_connection_limit", 0);
+    setValue("network/bandwidth_limit", 0);
+    setValue("network/host_bandwidth_limit", 0);
+    setValue("network/bandwidth_limit_window", "");
+    setValue("network/retry_count", 3);
+    setValue("network/retry_delay", 5);
+    setValue("network/retry_max_delay", 300);
+    setValue("network/connect_timeout", 30);
+    setValue("network/first_byte_timeout", 60);
+    setValue("network/idle_timeout", 60);
+    setValue("network/minimum_rate", 0);
+    setValue("network/minimum_rate_window", 60);
+    setValue("network/hedge_percentile", 0);
+    setValue("network/hedge_delay", 2000);
+    setValue("network/hedge_original_url", 0);
 }
 
 QString SettingsManager::getSaveLocation()
@@ -117,11 +214,146 @@ bool SettingsManager::getFilterExplicit()
     return m_filterExplicit;
 }
 
+int SettingsManager::getEpisodeThreadShare()
+{
+    return m_episodeThreadShare;
+}
+
+QString SettingsManager::getEpisodeOrder()
+{
+    return m_episodeOrder;
+}
+
+QString SettingsManager::getWriteBackend()
+{
+    return m_writeBackend;
+}
+
+QString SettingsManager::getHashAlgorithm()
+{
+    return m_hashAlgorithm;
+}
+
+bool SettingsManager::getDeduplicate()
+{
+    return m_deduplicate;
+}
+
+bool SettingsManager::getDeduplicatePrecheck()
+{
+    return m_deduplicatePrecheck;
+}
+
+QString SettingsManager::getSyncPolicy()
+{
+    return m_syncPolicy;
+}
+
+int SettingsManager::getSyncBatchSize()
+{
+    return m_syncBatchSize;
+}
+
+int SettingsManager::getStopAfterKnown()
+{
+    return m_stopAfterKnown;
+}
+
 bool SettingsManager::getIgnoreNotModified()
 {
     return m_ignoreNotModified;
 }
 
+int SettingsManager::getSegmentCount()
+{
+    return m_segmentCount;
+}
+
+qlonglong SettingsManager::getSegmentMinimumSize()
+{
+    return m_segmentMinimumSize;
+}
+
+int SettingsManager::getHostConnectionLimit()
+{
+    return m_hostConnectionLimit;
+}
+
+qlonglong SettingsManager::getBandwidthLimit()
+{
+    return m_bandwidthLimit;
+}
+
+qlonglong SettingsManager::getHostBandwidthLimit()
+{
+    return m_hostBandwidthLimit;
+}
+
+QTime SettingsManager::getBandwidthLimitStart()
+{
+    return m_bandwidthLimitStart;
+}
+
+QTime SettingsManager::getBandwidthLimitEnd()
+{
+    return m_bandwidthLimitEnd;
+}
+
+int SettingsManager::getRetryCount()
+{
+    return m_retryCount;
+}
+
+int SettingsManager::getRetryDelay()
+{
+    return m_retryDelay;
+}
+
+int SettingsManager::getRetryMaximumDelay()
+{
+    return m_retryMaximumDelay;
+}
+
+int SettingsManager::getConnectTimeout()
+{
+    return m_connectTimeout;
+}
+
+int SettingsManager::getFirstByteTimeout()
+{
+    return m_firstByteTimeout;
+}
+
+int SettingsManager::getIdleTimeout()
+{
+    return m_idleTimeout;
+}
+
+int SettingsManager::getMinimumRate()
+{
+    return m_minimumRate;
+}
+
+int SettingsManager::getMinimumRateWindow()
+{
+    return m_minimumRateWindow;
+}
+
+int SettingsManager::getHedgePercentile()
+{
+    return m_hedgePercentile;
+}
+
+int SettingsManager::getHedgeDelay()
+{
+    return m_hedgeDelay;
+}
+
+bool SettingsManager::getHedgeOriginalUrl()
+{
+    return m_hedgeOriginalUrl;
+}
+
 void SettingsManager::setSaveLocation(const QString &location)
 {
     m_saveLocation = location;
@@ -157,7 +389,145 @@ void SettingsManager::setFilterExplicit(bool filterExplicit)
     m_filterExplicit = filterExplicit;
 }
 
+void SettingsManager::setEpisodeThreadShare(int share)
+{
+    m_episodeThreadShare = qBound(0, share, 100);
+}
+
+void SettingsManager::setEpisodeOrder(const QString &order)
+{
+    m_episodeOrder = order;
+}
+
+void SettingsManager::setWriteBackend(const QString &backend)
+{
+    m_writeBackend = backend;
+}
+
+void SettingsManager::setHashAlgorithm(const QString &algorithm)
+{
+    m_hashAlgorithm = algorithm;
+}
+
+void SettingsManager::setDeduplicate(bool deduplicate)
+{
+    m_deduplicate = deduplicate;
+}
+
+void SettingsManager::setDeduplicatePrecheck(bool precheck)
+{
+    m_deduplicatePrecheck = precheck;
+}
+
+void SettingsManager::setSyncPolicy(const QString &policy)
+{
+    m_syncPolicy = policy;
+}
+
+void SettingsManager::setSyncBatchSize(int size)
+{
+    m_syncBatchSize = qMax(size, 1);
+}
+
+void SettingsManager::setStopAfterKnown(int count)
+{
+    m_stopAfterKnown = qMax(count, 0);
+}
+
 void SettingsManager::setIgnoreNotModified(bool ignore)
 {
     m_ignoreNotModified = ignore;
 }
+
+void SettingsManager::setSegmentCount(int count)
+{
+    m_segmentCount = qMax(count, 1);
+}
+
+void SettingsManager::setSegmentMinimumSize(qlonglong size)
+{
+    m_segmentMinimumSize = qMax(size, Q_INT64_C(0));
+}
+
+void SettingsManager::setHostConnectionLimit(int limit)
+{
+    m_hostConnectionLimit = qMax(limit, 0);
+}
+
+void SettingsManager::setBandwidthLimit(qlonglong limit)
+{
+    m_bandwidthLimit = qMax(limit, Q_INT64_C(0));
+}
+
+void SettingsManager::setHostBandwidthLimit(qlonglong limit)
+{
+    m_hostBandwidthLimit = qMax(limit, Q_INT64_C(0));
+}
+
+void SettingsManager::setBandwidthLimitWindow(const QString &window)
+{
+    // Anything that is not HH:mm-HH:mm leaves the times invalid which
+    // applies the limits all day.
+    m_bandwidthLimitStart = QTime::fromString(window.section('-', 0, 0)
+        .trimmed(), "HH:mm");
+    m_bandwidthLimitEnd = QTime::fromString(window.section('-', 1, 1)
+        .trimmed(), "HH:mm");
+}
+
+void SettingsManager::setRetryCount(int count)
+{
+    m_retryCount = qMax(count, 0);
+}
+
+void SettingsManager::setRetryDelay(int delay)
+{
+    m_retryDelay = qMax(delay, 0);
+}
+
+void SettingsManager::setRetryMaximumDelay(int delay)
+{
+    m_retryMaximumDelay = qMax(delay, 0);
+}
+
+void SettingsManager::setConnectTimeout(int timeout)
+{
+    m_connectTimeout = qMax(timeout, 0);
+}
+
+void SettingsManager::setFirstByteTimeout(int timeout)
+{
+    m_firstByteTimeout = qMax(timeout, 0);
+}
+
+void SettingsManager::setIdleTimeout(int timeout)
+{
+    m_idleTimeout = qMax(timeout, 0);
+}
+
+void SettingsManager::setMinimumRate(int rate)
+{
+    m_minimumRate = qMax(rate, 0);
+}
+
+void SettingsManager::setMinimumRateWindow(int window)
+{
+    m_minimumRateWindow = qMax(window, 1);
+}
+
+void SettingsManager::setHedgePercentile(int percentile)
+{
+    if (percentile < 1 || percentile > 99) {
+        percentile = 0;
+    }
+    m_hedgePercentile = percentile;
+}
+
+void SettingsManager::setHedgeDelay(int delay)
+{
+    m_hedgeDelay = qMax(delay, 1);
+}
+
+void SettingsManager::setHedgeOriginalUrl(bool original)
+{
+    m_hedgeOriginalUrl = original;
+}
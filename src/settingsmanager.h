@@ -22,6 +22,7 @@
 #define SETTINGSMANAGER_H
 
 #include <QSettings>
+#include <QTime>
 
 /**
  * Reads and caches the user settings for the application.
@@ -87,6 +88,70 @@ class SettingsManager : private QSettings
          * @return True if explicit episodes should be ignored.
          */
         bool getFilterExplicit();
+        /**
+         * The share of the download threads reserved for episodes once there
+         * are episodes to download.
+         *
+         * @return The share in percent. 0 to download every rss feed before
+         * any episodes.
+         */
+        int getEpisodeThreadShare();
+        /**
+         * The order episodes are downloaded in.
+         *
+         * @return One of round_robin, newest or shortest.
+         */
+        QString getEpisodeOrder();
+        /**
+         * How episode data is written to disk.
+         *
+         * @return One of buffered, direct, io_uring or none.
+         */
+        QString getWriteBackend();
+        /**
+         * The algorithm downloaded episodes are hashed with.
+         *
+         * @return One of sha256, sha1, md5 or none.
+         */
+        QString getHashAlgorithm();
+        /**
+         * Should episodes identical to one already downloaded be hard linked
+         * to it instead of stored twice.
+         *
+         * @return True to link identical episodes.
+         */
+        bool getDeduplicate();
+        /**
+         * Should an episode whose size and ETag match one already downloaded
+         * be linked without downloading it.
+         *
+         * @return True to skip downloading matching episodes.
+         */
+        bool getDeduplicatePrecheck();
+        /**
+         * When completed episodes are forced to disk before they are moved
+         * into place.
+         *
+         * @return One of file, batch or none.
+         */
+        QString getSyncPolicy();
+        /**
+         * The number of completed episodes synced together with the batch
+         * sync policy.
+         *
+         * @return The batch size. At least 1.
+         */
+        int getSyncBatchSize();
+        /**
+         * The number of episodes in a row already downloaded after which
+         * the rest of an rss feed is not read.
+         *
+         * Reading also stops once the recent episode count has been parsed.
+         * This assumes feeds list the newest episodes first.
+         *
+         * @return The number of episodes. 0 to always read the whole feed.
+         */
+        int getStopAfterKnown();
         /**
          * Should the not modifided response from the server be ignored.
          *
@@ -94,6 +159,127 @@ class SettingsManager : private QSettings
          * ignored.
          */
         bool getIgnoreNotModified();
+        /**
+         * The maximum number of segments a single episode can be split into
+         * and downloaded in parallel.
+         *
+         * Segments only use download threads that would otherwise be idle.
+         *
+         * @return The number of segments. 1 disables segmented downloads.
+         */
+        int getSegmentCount();
+        /**
+         * The minimum size of an episode before it will be split into
+         * segments.
+         *
+         * @return The size in KB.
+         */
+        qlonglong getSegmentMinimumSize();
+        /**
+         * The maximum number of simultaneous connections to a single host.
+         *
+         * @return The connection limit. 0 for no limit.
+         */
+        int getHostConnectionLimit();
+        /**
+         * The maximum total download rate.
+         *
+         * @return The rate in KB per second. 0 for no limit.
+         */
+        qlonglong getBandwidthLimit();
+        /**
+         * The maximum download rate from a single host.
+         *
+         * @return The rate in KB per second. 0 for no limit.
+         */
+        qlonglong getHostBandwidthLimit();
+        /**
+         * The time of day the bandwidth limits start applying.
+         *
+         * @return The start time. An invalid time if the limits apply all
+         * day.
+         */
+        QTime getBandwidthLimitStart();
+        /**
+         * The time of day the bandwidth limits stop applying.
+         *
+         * @return The end time. An invalid time if the limits apply all day.
+         */
+        QTime getBandwidthLimitEnd();
+        /**
+         * The number of times a download that failed because of a network
+         * or server problem is tried again.
+         *
+         * @return The number of retries. 0 to never retry.
+         */
+        int getRetryCount();
+        /**
+         * How long to wait before the first retry. Each following retry
+         * waits twice as long.
+         *
+         * @return The delay in seconds.
+         */
+        int getRetryDelay();
+        /**
+         * The longest time to wait before a retry.
+         *
+         * @return The delay in seconds.
+         */
+        int getRetryMaximumDelay();
+        /**
+         * How long to wait for a server to respond to a request.
+         *
+         * @return The timeout in seconds. 0 for no limit.
+         */
+        int getConnectTimeout();
+        /**
+         * How long to wait for the first data once a server has responded.
+         *
+         * @return The timeout in seconds. 0 for no limit.
+         */
+        int getFirstByteTimeout();
+        /**
+         * How long a download can go without receiving data.
+         *
+         * @return The timeout in seconds. 0 for no limit.
+         */
+        int getIdleTimeout();
+        /**
+         * The slowest rate an episode can download at before it is stopped
+         * and tried again.
+         *
+         * @return The rate in KB per second. 0 for no limit.
+         */
+        int getMinimumRate();
+        /**
+         * The time the download rate is averaged over when comparing it to
+         * the minimum rate.
+         *
+         * @return The window in seconds.
+         */
+        int getMinimumRateWindow();
+        /**
+         * The percentile of recent response times an episode request can
+         * wait for before a second request for it is sent.
+         *
+         * @return The percentile. 0 to not send second requests.
+         */
+        int getHedgePercentile();
+        /**
+         * The shortest time an episode request waits for a response before
+         * a second request is sent. Also used until enough response times
+         * have been seen to work out the percentile.
+         *
+         * @return The delay in milliseconds.
+         */
+        int getHedgeDelay();
+        /**
+         * Send the second request to the url listed in the rss feed instead
+         * of the url the first request was redirected to.
+         *
+         * @return True to use the url before redirects.
+         */
+        bool getHedgeOriginalUrl();
 
         /**
          * Sets the location that podcasts should be saved in.
@@ -140,6 +326,68 @@ class SettingsManager : private QSettings
          * @param filterExplicit True if explicit episodes should be ignored.
          */
         void setFilterExplicit(bool filterExplicit);
+        /**
+         * The share of the download threads reserved for episodes once there
+         * are episodes to download.
+         *
+         * @param share The share in percent. 0 to download every rss feed
+         * before any episodes.
+         */
+        void setEpisodeThreadShare(int share);
+        /**
+         * The order episodes are downloaded in.
+         *
+         * @param order One of round_robin, newest or shortest.
+         */
+        void setEpisodeOrder(const QString &order);
+        /**
+         * How episode data is written to disk.
+         *
+         * @param backend One of buffered, direct, io_uring or none.
+         */
+        void setWriteBackend(const QString &backend);
+        /**
+         * The algorithm downloaded episodes are hashed with.
+         *
+         * @param algorithm One of sha256, sha1, md5 or none.
+         */
+        void setHashAlgorithm(const QString &algorithm);
+        /**
+         * Should episodes identical to one already downloaded be hard linked
+         * to it instead of stored twice.
+         *
+         * @param deduplicate True to link identical episodes.
+         */
+        void setDeduplicate(bool deduplicate);
+        /**
+         * Should an episode whose size and ETag match one already downloaded
+         * be linked without downloading it.
+         *
+         * @param precheck True to skip downloading matching episodes.
+         */
+        void setDeduplicatePrecheck(bool precheck);
+        /**
+         * When completed episodes are forced to disk before they are moved
+         * into place.
+         *
+         * @param policy One of file, batch or none.
+         */
+        void setSyncPolicy(const QString &policy);
+        /**
+         * The number of completed episodes synced together with the batch
+         * sync policy.
+         *
+         * @param size The batch size. Anything under 1 is set to 1.
+         */
+        void setSyncBatchSize(int size);
+        /**
+         * The number of episodes in a row already downloaded after which
+         * the rest of an rss feed is not read.
+         *
+         * @param count The number of episodes. 0 to always read the whole
+         * feed.
+         */
+        void setStopAfterKnown(int count);
         /**
          * Should the not modifided response from the server be ignored.
          *
@@ -147,6 +395,120 @@ class SettingsManager : private QSettings
          * ignored.
          */
         void setIgnoreNotModified(bool ignore);
+        /**
+         * The maximum number of segments a single episode can be split into
+         * and downloaded in parallel.
+         *
+         * @param count The number of segments. 1 disables segmented downloads.
+         */
+        void setSegmentCount(int count);
+        /**
+         * The minimum size of an episode before it will be split into
+         * segments.
+         *
+         * @param size The size in KB.
+         */
+        void setSegmentMinimumSize(qlonglong size);
+        /**
+         * The maximum number of simultaneous connections to a single host.
+         *
+         * @param limit The connection limit. 0 for no limit.
+         */
+        void setHostConnectionLimit(int limit);
+        /**
+         * The maximum total download rate.
+         *
+         * @param limit The rate in KB per second. 0 for no limit.
+         */
+        void setBandwidthLimit(qlonglong limit);
+        /**
+         * The maximum download rate from a single host.
+         *
+         * @param limit The rate in KB per second. 0 for no limit.
+         */
+        void setHostBandwidthLimit(qlonglong limit);
+        /**
+         * The time of day the bandwidth limits apply.
+         *
+         * @param window The window in the form HH:mm-HH:mm. An empty string
+         * applies the limits all day.
+         */
+        void setBandwidthLimitWindow(const QString &window);
+        /**
+         * The number of times a download that failed because of a network
+         * or server problem is tried again.
+         *
+         * @param count The number of retries. 0 to never retry.
+         */
+        void setRetryCount(int count);
+        /**
+         * How long to wait before the first retry.
+         *
+         * @param delay The delay in seconds.
+         */
+        void setRetryDelay(int delay);
+        /**
+         * The longest time to wait before a retry.
+         *
+         * @param delay The delay in seconds.
+         */
+        void setRetryMaximumDelay(int delay);
+        /**
+         * How long to wait for a server to respond to a request.
+         *
+         * @param timeout The timeout in seconds. 0 for no limit.
+         */
+        void setConnectTimeout(int timeout);
+        /**
+         * How long to wait for the first data once a server has responded.
+         *
+         * @param timeout The timeout in seconds. 0 for no limit.
+         */
+        void setFirstByteTimeout(int timeout);
+        /**
+         * How long a download can go without receiving data.
+         *
+         * @param timeout The timeout in seconds. 0 for no limit.
+         */
+        void setIdleTimeout(int timeout);
+        /**
+         * The slowest rate an episode can download at before it is stopped
+         * and tried again.
+         *
+         * @param rate The rate in KB per second. 0 for no limit.
+         */
+        void setMinimumRate(int rate);
+        /**
+         * The time the download rate is averaged over when comparing it to
+         * the minimum rate.
+         *
+         * @param window The window in seconds. Anything under 1 is set to
+         * 1.
+         */
+        void setMinimumRateWindow(int window);
+        /**
+         * The percentile of recent response times an episode request can
+         * wait for before a second request for it is sent.
+         *
+         * @param percentile The percentile. Anything outside of 1 to 99
+         * disables second requests.
+         */
+        void setHedgePercentile(int percentile);
+        /**
+         * The shortest time an episode request waits for a response before
+         * a second request is sent.
+         *
+         * @param delay The delay in milliseconds. Anything under 1 is set to
+         * 1.
+         */
+        void setHedgeDelay(int delay);
+        /**
+         * Send the second request to the url listed in the rss feed instead
+         * of the url the first request was redirected to.
+         *
+         * @param original True to use the url before redirects.
+         */
+        void setHedgeOriginalUrl(bool original);
 
     private:
         /**
@@ -180,10 +542,119 @@ class SettingsManager : private QSettings
          * Whether explicit episodes should be ignored;
          */
         bool m_filterExplicit;
+        /**
+         * The percent of the download threads reserved for episodes.
+         */
+        int m_episodeThreadShare;
+        /**
+         * The order episodes are downloaded in.
+         */
+        QString m_episodeOrder;
+        /**
+         * How episode data is written to disk.
+         */
+        QString m_writeBackend;
+        /**
+         * The algorithm downloaded episodes are hashed with.
+         */
+        QString m_hashAlgorithm;
+        /**
+         * Whether identical episodes are linked.
+         */
+        bool m_deduplicate;
+        /**
+         * Whether episodes matching by size and ETag are not downloaded.
+         */
+        bool m_deduplicatePrecheck;
+        /**
+         * When completed episodes are synced.
+         */
+        QString m_syncPolicy;
+        /**
+         * The number of episodes synced together.
+         */
+        int m_syncBatchSize;
+        /**
+         * The number of downloaded episodes in a row that stops reading a
+         * feed.
+         */
+        int m_stopAfterKnown;
         /**
          * Whether not modifided responses should be ignored.
          */
         bool m_ignoreNotModified;
+        /**
+         * The maximum number of segments to split an episode into.
+         */
+        int m_segmentCount;
+        /**
+         * The minimum size of an episode that will be split into segments.
+         */
+        qlonglong m_segmentMinimumSize;
+        /**
+         * The maximum number of simultaneous connections to a single host.
+         */
+        int m_hostConnectionLimit;
+        /**
+         * The maximum total download rate in KB per second.
+         */
+        qlonglong m_bandwidthLimit;
+        /**
+         * The maximum download rate from a single host in KB per second.
+         */
+        qlonglong m_hostBandwidthLimit;
+        /**
+         * When the bandwidth limits start applying.
+         */
+        QTime m_bandwidthLimitStart;
+        /**
+         * When the bandwidth limits stop applying.
+         */
+        QTime m_bandwidthLimitEnd;
+        /**
+         * The number of times a failed download is tried again.
+         */
+        int m_retryCount;
+        /**
+         * The delay before the first retry in seconds.
+         */
+        int m_retryDelay;
+        /**
+         * The longest delay before a retry in seconds.
+         */
+        int m_retryMaximumDelay;
+        /**
+         * Seconds to wait for a response.
+         */
+        int m_connectTimeout;
+        /**
+         * Seconds to wait for the first data.
+         */
+        int m_firstByteTimeout;
+        /**
+         * Seconds a download can go without data.
+         */
+        int m_idleTimeout;
+        /**
+         * The minimum episode download rate in KB per second.
+         */
+        int m_minimumRate;
+        /**
+         * Seconds the download rate is averaged over.
+         */
+        int m_minimumRateWindow;
+        /**
+         * The response time percentile that triggers a second request.
+         */
+        int m_hedgePercentile;
+        /**
+         * The shortest wait in milliseconds before a second request.
+         */
+        int m_hedgeDelay;
+        /**
+         * Whether second requests use the url before redirects.
+         */
+        bool m_hedgeOriginalUrl;
 };
 
 #endif /* SETTINGSMANAGER_H */
@@ -0,0 +1,186 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include "sha256.h"
+
+// The round constants from FIPS 180-4.
+static const quint32 roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline quint32 rotateRight(quint32 value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+Sha256::Sha256()
+{
+    reset();
+}
+
+void Sha256::reset()
+{
+    m_state[0] = 0x6a09e667;
+    m_state[1] = 0xbb67ae85;
+    m_state[2] = 0x3c6ef372;
+    m_state[3] = 0xa54ff53a;
+    m_state[4] = 0x510e527f;
+    m_state[5] = 0x9b05688c;
+    m_state[6] = 0x1f83d9ab;
+    m_state[7] = 0x5be0cd19;
+    m_blockLength = 0;
+    m_length = 0;
+}
+
+void Sha256::addData(const char *data, int length)
+{
+    const uchar *input = reinterpret_cast<const uchar *>(data);
+
+    if (length <= 0) {
+        return;
+    }
+    m_length += length;
+
+    // Finish a block started by an earlier call.
+    if (m_blockLength > 0) {
+        int count = qMin(64 - m_blockLength, length);
+        memcpy(m_block + m_blockLength, input, count);
+        m_blockLength += count;
+        input += count;
+        length -= count;
+
+        if (m_blockLength < 64) {
+            return;
+        }
+        transform(m_state, m_block);
+        m_blockLength = 0;
+    }
+
+    // Whole blocks are hashed straight from the input.
+    while (length >= 64) {
+        transform(m_state, input);
+        input += 64;
+        length -= 64;
+    }
+
+    memcpy(m_block, input, length);
+    m_blockLength = length;
+}
+
+QByteArray Sha256::result() const
+{
+    quint32 state[8];
+    uchar block[128];
+    int blockCount = m_blockLength < 56 ? 1 : 2;
+    quint64 bits = m_length * 8;
+
+    memcpy(state, m_state, sizeof(state));
+
+    // Pad with a single 1 bit, zeros and the length in bits.
+    memset(block, 0, sizeof(block));
+    memcpy(block, m_block, m_blockLength);
+    block[m_blockLength] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        block[blockCount * 64 - 1 - i] = static_cast<uchar>(bits >> (i * 8));
+    }
+
+    for (int i = 0; i < blockCount; i++) {
+        transform(state, block + i * 64);
+    }
+
+    QByteArray hash(32, 0);
+    for (int i = 0; i < 8; i++) {
+        hash[i * 4] = static_cast<char>(state[i] >> 24);
+        hash[i * 4 + 1] = static_cast<char>(state[i] >> 16);
+        hash[i * 4 + 2] = static_cast<char>(state[i] >> 8);
+        hash[i * 4 + 3] = static_cast<char>(state[i]);
+    }
+
+    return hash;
+}
+
+void Sha256::transform(quint32 *state, const uchar *block)
+{
+    quint32 w[64];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = (static_cast<quint32>(block[i * 4]) << 24)
+            | (static_cast<quint32>(block[i * 4 + 1]) << 16)
+            | (static_cast<quint32>(block[i * 4 + 2]) << 8)
+            | static_cast<quint32>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        quint32 s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18)
+            ^ (w[i - 15] >> 3);
+        quint32 s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19)
+            ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    quint32 a = state[0];
+    quint32 b = state[1];
+    quint32 c = state[2];
+    quint32 d = state[3];
+    quint32 e = state[4];
+    quint32 f = state[5];
+    quint32 g = state[6];
+    quint32 h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        quint32 s1 = rotateRight(e, 6) ^ rotateRight(e, 11)
+            ^ rotateRight(e, 25);
+        quint32 choice = (e & f) ^ (~e & g);
+        quint32 temp1 = h + s1 + choice + roundConstants[i] + w[i];
+        quint32 s0 = rotateRight(a, 2) ^ rotateRight(a, 13)
+            ^ rotateRight(a, 22);
+        quint32 majority = (a & b) ^ (a & c) ^ (b & c);
+        quint32 temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
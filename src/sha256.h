@@ -0,0 +1,84 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <QByteArray>
+
+/**
+ * Computes a SHA-256 hash incrementally.
+ *
+ * QCryptographicHash in Qt 4 does not provide SHA-256. The interface follows
+ * QCryptographicHash so the two can be used the same way.
+ */
+class Sha256
+{
+    public:
+        Sha256();
+
+        /**
+         * Start a new hash discarding any data added so far.
+         */
+        void reset();
+        /**
+         * Add data to the hash.
+         *
+         * @param data The data.
+         * @param length The number of bytes.
+         */
+        void addData(const char *data, int length);
+        /**
+         * Gets the hash of the data added so far.
+         *
+         * More data can still be added afterwards.
+         *
+         * @return The 32 byte hash.
+         */
+        QByteArray result() const;
+
+    private:
+        /**
+         * Process one 64 byte block.
+         *
+         * @param state The hash state to update.
+         * @param block The block.
+         */
+        static void transform(quint32 *state, const uchar *block);
+
+        /**
+         * The hash state.
+         */
+        quint32 m_state[8];
+        /**
+         * Data that does not yet fill a block.
+         */
+        uchar m_block[64];
+        /**
+         * The number of bytes in m_block.
+         */
+        int m_blockLength;
+        /**
+         * The total number of bytes added.
+         */
+        quint64 m_length;
+};
+
+#endif /* SHA256_H */
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include <QObject>
+
+#include "streamdecoder.h"
+
+StreamDecoder::StreamDecoder()
+{
+    m_encoding = IdentityEncoding;
+    m_initialized = false;
+    m_finished = false;
+    m_rawDeflate = false;
+}
+
+StreamDecoder::~StreamDecoder()
+{
+    end();
+}
+
+StreamDecoder::Encoding StreamDecoder::encodingFromHeader(
+    const QByteArray &header)
+{
+    QByteArray encoding = header.trimmed().toLower();
+
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        return GzipEncoding;
+    }
+    else if (encoding == "deflate") {
+        return DeflateEncoding;
+    }
+    return IdentityEncoding;
+}
+
+bool StreamDecoder::reset(Encoding encoding)
+{
+    end();
+
+    m_encoding = encoding;
+    m_finished = false;
+    m_rawDeflate = false;
+    m_error.clear();
+
+    if (m_encoding == IdentityEncoding) {
+        return true;
+    }
+
+    m_stream.zalloc = Z_NULL;
+    m_stream.zfree = Z_NULL;
+    m_stream.opaque = Z_NULL;
+    m_stream.next_in = Z_NULL;
+    m_stream.avail_in = 0;
+
+    // Adding 32 to the window bits has zlib detect a gzip or zlib header.
+    if (inflateInit2(&m_stream, MAX_WBITS + 32) != Z_OK) {
+        m_error = QObject::tr("could not initialize zlib");
+        return false;
+    }
+    m_initialized = true;
+
+    return true;
+}
+
+bool StreamDecoder::decode(const QByteArray &data, QByteArray *decoded)
+{
+    if (m_encoding == IdentityEncoding) {
+        decoded->append(data);
+        return true;
+    }
+    if (!m_initialized) {
+        return false;
+    }
+    if (m_finished || data.isEmpty()) {
+        return true;
+    }
+
+    char buffer[16384];
+
+    m_stream.next_in = reinterpret_cast<Bytef *>(
+        const_cast<char *>(data.constData()));
+    m_stream.avail_in = data.size();
+
+    do {
+        m_stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        m_stream.avail_out = sizeof(buffer);
+
+        int ret = inflate(&m_stream, Z_NO_FLUSH);
+
+        // Some servers send raw deflate data instead of the zlib format
+        // HTTP calls for. That can only be detected at the start of the
+        // body.
+        if (ret == Z_DATA_ERROR && m_encoding == DeflateEncoding
+            && !m_rawDeflate && m_stream.total_out == 0
+            && m_stream.total_in <= static_cast<uLong>(data.size()))
+        {
+            inflateEnd(&m_stream);
+            m_initialized = false;
+            if (inflateInit2(&m_stream, -MAX_WBITS) != Z_OK) {
+                m_error = QObject::tr("could not initialize zlib");
+                return false;
+            }
+            m_initialized = true;
+            m_rawDeflate = true;
+
+            m_stream.next_in = reinterpret_cast<Bytef *>(
+                const_cast<char *>(data.constData()));
+            m_stream.avail_in = data.size();
+            continue;
+        }
+
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            m_error = QObject::tr("the compressed data is corrupt");
+            return false;
+        }
+
+        decoded->append(buffer, sizeof(buffer) - m_stream.avail_out);
+
+        // Anything after the end of the stream is ignored.
+        if (ret == Z_STREAM_END) {
+            m_finished = true;
+            break;
+        }
+        // No progress can be made until more data arrives.
+        if (ret == Z_BUF_ERROR) {
+            break;
+        }
+    } while (m_stream.avail_in > 0 || m_stream.avail_out == 0);
+
+    return true;
+}
+
+QString StreamDecoder::errorString() const
+{
+    return m_error;
+}
+
+void StreamDecoder::end()
+{
+    if (m_initialized) {
+        inflateEnd(&m_stream);
+        m_initialized = false;
+    }
+}
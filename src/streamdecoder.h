@@ -0,0 +1,117 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef STREAMDECODER_H
+#define STREAMDECODER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <zlib.h>
+
+/**
+ * Decodes a gzip or deflate content encoded HTTP body as it is downloaded.
+ *
+ * Data can be given to the decoder in pieces as it arrives. Each piece is
+ * decoded as far as possible so the whole compressed body never needs to be
+ * held in memory.
+ */
+class StreamDecoder
+{
+    public:
+        /**
+         * The content encodings that can be decoded.
+         */
+        enum Encoding {
+            IdentityEncoding,
+            GzipEncoding,
+            DeflateEncoding
+        };
+
+        StreamDecoder();
+        ~StreamDecoder();
+
+        /**
+         * Gets the encoding named by a Content-Encoding header.
+         *
+         * @param header The value of the Content-Encoding header.
+         *
+         * @return The encoding. IdentityEncoding if the header is empty or
+         * names an encoding that is not supported.
+         */
+        static Encoding encodingFromHeader(const QByteArray &header);
+
+        /**
+         * Start decoding a new body.
+         *
+         * @param encoding The encoding of the body.
+         *
+         * @return True if the decoder could be set up.
+         */
+        bool reset(Encoding encoding);
+        /**
+         * Decode the next piece of the body.
+         *
+         * @param data The encoded data.
+         * @param decoded The decoded data is appended to this.
+         *
+         * @return True on success. False if the data could not be decoded.
+         */
+        bool decode(const QByteArray &data, QByteArray *decoded);
+        /**
+         * The error from the last failed decode.
+         *
+         * @return A human readable description of the error.
+         */
+        QString errorString() const;
+
+    private:
+        /**
+         * Free the zlib stream.
+         */
+        void end();
+
+        /**
+         * The encoding being decoded.
+         */
+        Encoding m_encoding;
+        /**
+         * The zlib stream state.
+         */
+        z_stream m_stream;
+        /**
+         * Whether m_stream has been initialized.
+         */
+        bool m_initialized;
+        /**
+         * Whether the end of the compressed stream has been reached.
+         */
+        bool m_finished;
+        /**
+         * Whether a deflate body is being treated as raw deflate data.
+         */
+        bool m_rawDeflate;
+        /**
+         * The error from the last failed decode.
+         */
+        QString m_error;
+};
+
+#endif /* STREAMDECODER_H */
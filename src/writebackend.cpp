@@ -0,0 +1,92 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#include "bufferedwritebackend.h"
+#include "directwritebackend.h"
+#include "iouringwritebackend.h"
+#include "writebackend.h"
+
+WriteBackend::~WriteBackend()
+{
+}
+
+WriteBackend *WriteBackend::create(Type type)
+{
+    switch (type) {
+        case DirectBackend:
+#ifdef HAVE_DIRECT_WRITE
+            return new DirectWriteBackend();
+#else
+            return 0;
+#endif
+        case IoUringBackend: {
+#ifdef HAVE_IO_URING_WRITE
+            // io_uring can be refused at run time such as by a seccomp
+            // filter or an old kernel.
+            IoUringWriteBackend *backend = new IoUringWriteBackend();
+            if (!backend->isReady()) {
+                delete backend;
+                return 0;
+            }
+            return backend;
+#else
+            return 0;
+#endif
+        }
+        case BufferedBackend:
+        default:
+            return new BufferedWriteBackend();
+    }
+}
+
+void WriteBackend::writeBatch(QList<Request> &requests)
+{
+    for (int i = 0; i < requests.size(); i++) {
+        Request &request = requests[i];
+        request.ok = write(request.handle, request.position, request.data,
+            request.size);
+    }
+}
+
+int WriteBackend::getBatchSize() const
+{
+    return 1;
+}
+
+WriteBackend::Type WriteBackend::typeFromName(const QString &name, bool *ok)
+{
+    QString type = name.trimmed().toLower();
+
+    if (ok) {
+        *ok = true;
+    }
+
+    if (type == "direct") {
+        return DirectBackend;
+    }
+    else if (type == "io_uring") {
+        return IoUringBackend;
+    }
+    else if (type != "buffered" && ok) {
+        *ok = false;
+    }
+
+    return BufferedBackend;
+}
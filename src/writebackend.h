@@ -0,0 +1,147 @@
+/*****************************************************************************
+ *   Copyright (C) 2008 John Schember <john@nachtimwald.com>                 *
+ *                                                                           *
+ *   This file is part of niwpodcastdownloader.                              *
+ *                                                                           *
+ *   niwpodcastdownloader is free software: you can redistribute it and/or   *
+ *   modify it under the terms of the GNU General Public License as          *
+ *   published by the Free Software Foundation, either version 3 of the      *
+ *   License, or (at your option) any later version.                         *
+ *                                                                           *
+ *   niwpodcastdownloader is distributed in the hope that it will be useful, *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with niwpodcastdownloader. If not, see                            *
+ *   <http://www.gnu.org/licenses/>.                                         *
+ *****************************************************************************/
+
+#ifndef WRITEBACKEND_H
+#define WRITEBACKEND_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * Writes episode data to disk for DiskWriter.
+ *
+ * Files are identified by a handle chosen by the caller. All functions are
+ * called from the disk writer thread only.
+ */
+class WriteBackend
+{
+    public:
+        /**
+         * The available backends.
+         */
+        enum Type {
+            /**
+             * Normal buffered writes through the operating system's cache.
+             */
+            BufferedBackend,
+            /**
+             * Writes that bypass the operating system's cache (O_DIRECT).
+             * Linux only.
+             */
+            DirectBackend,
+            /**
+             * Writes submitted through io_uring. Linux only and requires
+             * liburing at build time.
+             */
+            IoUringBackend
+        };
+
+        /**
+         * A write given to writeBatch.
+         */
+        struct Request {
+            int handle;
+            qint64 position;
+            const char *data;
+            qint64 size;
+            /**
+             * Set by writeBatch to whether all of the data was written.
+             */
+            bool ok;
+        };
+
+        virtual ~WriteBackend();
+
+        /**
+         * Creates a backend.
+         *
+         * @param type The backend to create.
+         *
+         * @return The backend. 0 if it is not supported on this platform or
+         * could not be set up.
+         */
+        static WriteBackend *create(Type type);
+        /**
+         * Gets the backend type for a name.
+         *
+         * @param name One of buffered, direct or io_uring.
+         * @param ok Set to false if the name is not known.
+         *
+         * @return The backend type. BufferedBackend if the name is not
+         * known.
+         */
+        static Type typeFromName(const QString &name, bool *ok=0);
+
+        /**
+         * Gets the name of the backend.
+         *
+         * @return The name used to select the backend.
+         */
+        virtual QString getName() const = 0;
+        /**
+         * Opens a file for writing. The file is created if it does not exist
+         * and is not truncated.
+         *
+         * @param handle The handle to refer to the file by.
+         * @param path The file name including path.
+         *
+         * @return True if the file was opened.
+         */
+        virtual bool open(int handle, const QString &path) = 0;
+        /**
+         * Writes data to an open file.
+         *
+         * @param handle The file.
+         * @param position Where to write the data.
+         * @param data The data to write.
+         * @param size The number of bytes to write.
+         *
+         * @return True if all of the data was written.
+         */
+        virtual bool write(int handle, qint64 position, const char *data,
+            qint64 size) = 0;
+        /**
+         * Writes several pieces of data.
+         *
+         * The default writes them one at a time with write.
+         *
+         * @param requests The writes. ok is set on each.
+         */
+        virtual void writeBatch(QList<Request> &requests);
+        /**
+         * Gets the largest number of writes worth giving to writeBatch at
+         * once.
+         *
+         * @return The batch size. 1 if the backend gains nothing from
+         * batching.
+         */
+        virtual int getBatchSize() const;
+        /**
+         * Closes a file.
+         *
+         * @param handle The file.
+         *
+         * @return True if everything written to the file was handed to the
+         * operating system.
+         */
+        virtual bool close(int handle) = 0;
+};
+
+#endif /* WRITEBACKEND_H */